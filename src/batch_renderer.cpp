@@ -0,0 +1,527 @@
+#include "batch_renderer.hpp"
+#include "cpu_topology.hpp"
+#include "tile_codec.hpp"
+#include "zoom_path.hpp"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// Preemption granularity: about this long between checks for a better job
+const double BAND_TARGET_SECONDS = 0.1;
+
+// Frames of a zoom path probed for its queue cost
+const int PATH_COST_PROBES = 4;
+
+// Tiles one submission may ask for: half the cache, counting tiles at their raw size
+// (compressed ones are smaller), so a band's first tiles aren't evicted by its last
+static int64_t cacheTileBudget(const TileCache& cache) {
+    return std::max<int64_t>(1, cache.getCapacity() / (2 * TILE_SIZE * TILE_SIZE * sizeof(int)));
+}
+
+static bool saveImagePng(const std::string& filename, int width, int height, unsigned char* image) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceFrom(image, width, height, 24, width * 3,
+        0x0000FF, 0x00FF00, 0xFF0000, 0);
+    if (!surface) {
+        std::cerr << "Error creating surface: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    bool saved = IMG_SavePNG(surface, filename.c_str()) == 0;
+    if (!saved) {
+        std::cerr << "Error saving PNG: " << IMG_GetError() << std::endl;
+    }
+    SDL_FreeSurface(surface);
+    return saved;
+}
+
+// Raw export: fixed header followed by the TileCodec stream of the whole image
+struct RawIterationsHeader {
+    char magic[4];  // "MBIT"
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t maxIterations;
+    uint32_t reserved;
+    double centerX;
+    double centerY;
+    double zoom;
+    uint64_t payloadBytes;
+};
+
+static bool saveRawIterations(const RenderJob& job) {
+    std::vector<uint8_t> payload;
+    TileCodec::encode(job.iterations.data(), job.width, job.height, payload);
+
+    RawIterationsHeader header = {{'M', 'B', 'I', 'T'}, 1, job.width, job.height, job.maxIterations, 0,
+                                  job.centerX, job.centerY, job.zoom, payload.size()};
+    std::ofstream file(job.rawOutput, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    if (!file) {
+        std::cerr << "Error writing " << job.rawOutput << std::endl;
+        return false;
+    }
+    std::cout << "Wrote " << payload.size() << " bytes of iterations ("
+              << job.iterations.size() * sizeof(int) << " raw) to " << job.rawOutput << std::endl;
+    return true;
+}
+
+static void renameJobFile(RenderJob& job, const std::string& suffix) {
+    std::error_code error;
+    std::string renamed = job.jobFile.substr(0, job.jobFile.rfind(".job")) + ".job" + suffix;
+    fs::rename(job.jobFile, renamed, error);
+    if (!error) {
+        job.jobFile = renamed;
+    }
+}
+
+BatchRenderer::BatchRenderer(const std::string& spoolDirectory, RenderScheduler& scheduler, TileCache& cache)
+    : spoolDirectory(spoolDirectory), scheduler(scheduler), cache(cache),
+      clientId(scheduler.addClient()), nextJobId(1), estimator(scheduler.getWorkerCount()), stopping(false)
+{
+    try {
+        openclRenderer.reset(new MandelbrotViewer(TILE_SIZE, TILE_SIZE, 200, 1, 1.8));
+        estimator.setOpenCLAvailable(true);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "OpenCL unavailable, batch jobs render on the CPU: " << e.what() << std::endl;
+    }
+
+    const int nodeCount = static_cast<int>(CpuTopology::nodes().size());
+    colorQueues.resize(nodeCount);
+    for (int node = 0; node < nodeCount; ++node) {
+        colorThreads.emplace_back(&BatchRenderer::colorLoop, this, node);
+    }
+}
+
+BatchRenderer::~BatchRenderer() {
+    {
+        std::lock_guard<std::mutex> lock(colorMutex);
+        stopping = true;
+    }
+    colorAvailable.notify_all();
+    for (std::thread& thread : colorThreads) {
+        thread.join();
+    }
+}
+
+int BatchRenderer::bandNode(int band) const {
+    return band % static_cast<int>(colorQueues.size());
+}
+
+void BatchRenderer::allocateImage(RenderJob& job) {
+    // Left untouched here: each band's pages are bound to the node that will colour it
+    job.image.resize(static_cast<size_t>(job.width) * job.height * 3);
+    if (!job.rawOutput.empty()) {
+        job.iterations.resize(static_cast<size_t>(job.width) * job.height);
+    }
+    if (colorQueues.size() < 2) {
+        return;
+    }
+
+    const double pixelSize = 4.0 / job.zoom / job.height;
+    const int64_t originY = std::llround(job.centerY / pixelSize) - job.height / 2;
+    const int64_t firstTileY = TileRenderer::tileIndex(originY);
+    for (int band = 0; band < job.bandCount; ++band) {
+        const int64_t bandTileY = firstTileY + static_cast<int64_t>(band) * job.bandRows;
+        const int64_t rowBegin = std::max<int64_t>(0, bandTileY * TILE_SIZE - originY);
+        const int64_t rowEnd = std::min<int64_t>(job.height, (bandTileY + job.bandRows) * TILE_SIZE - originY);
+        if (rowEnd <= rowBegin) {
+            continue;
+        }
+        const size_t rows = static_cast<size_t>(rowEnd - rowBegin);
+        CpuTopology::bindMemory(job.image.data() + static_cast<size_t>(rowBegin) * job.width * 3,
+                                rows * job.width * 3, bandNode(band));
+        if (!job.iterations.empty()) {
+            CpuTopology::bindMemory(job.iterations.data() + static_cast<size_t>(rowBegin) * job.width,
+                                    rows * job.width * sizeof(int), bandNode(band));
+        }
+    }
+}
+
+void BatchRenderer::colorLoop(int node) {
+    CpuTopology::pinCurrentThreadToNode(node);
+    std::vector<unsigned char> tileRgb(TILE_SIZE * TILE_SIZE * 3);
+
+    while (true) {
+        ColorTask task;
+        {
+            std::unique_lock<std::mutex> lock(colorMutex);
+            colorAvailable.wait(lock, [&] { return stopping || !colorQueues[node].empty(); });
+            if (colorQueues[node].empty()) {
+                return;
+            }
+            task = std::move(colorQueues[node].front());
+            colorQueues[node].pop_front();
+        }
+
+        RenderJob& job = *task.job;
+        for (size_t i = 0; i < task.keys.size(); ++i) {
+            const TileIterations& tile = *task.tiles[i];
+            TileRenderer::colorize(tile.data(), tile.size(), job.maxIterations,
+                                   job.colorMode, job.colorShift, tileRgb.data());
+            const int64_t tileLeft = task.keys[i].tileX * TILE_SIZE - task.originX;
+            const int64_t tileTop = task.keys[i].tileY * TILE_SIZE - task.originY;
+            int x0, y0, x1, y1;
+            if (TileRenderer::copyTileToImage(tileRgb.data(), tileLeft, tileTop, job.image.data(),
+                                              job.width, job.height, x0, y0, x1, y1) &&
+                !job.iterations.empty()) {
+                for (int y = y0; y < y1; ++y) {
+                    const int* src = tile.data() + (y - tileTop) * TILE_SIZE + (x0 - tileLeft);
+                    std::copy(src, src + (x1 - x0), job.iterations.begin() + static_cast<size_t>(y) * job.width + x0);
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(colorMutex);
+            --job.colorTasksPending;
+        }
+        colorFinished.notify_all();
+    }
+}
+
+void BatchRenderer::scanSpool() {
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(spoolDirectory, error)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".job") {
+            continue;
+        }
+
+        std::ifstream file(entry.path());
+        std::stringstream text;
+        text << file.rdbuf();
+
+        auto job = std::make_shared<RenderJob>();
+        job->jobFile = entry.path().string();
+        std::string parseError;
+        if (!parseRenderJob(text.str(), *job, parseError)) {
+            std::cerr << "Rejected " << job->jobFile << ": " << parseError << std::endl;
+            renameJobFile(*job, ".failed");
+            continue;
+        }
+
+        job->id = nextJobId++;
+        if (job->name.empty()) {
+            job->name = entry.path().stem().string();
+        }
+        // Relative outputs land next to the job file
+        if (fs::path(job->output).is_relative()) {
+            job->output = (fs::path(spoolDirectory) / job->output).string();
+        }
+        if (!job->rawOutput.empty() && fs::path(job->rawOutput).is_relative()) {
+            job->rawOutput = (fs::path(spoolDirectory) / job->rawOutput).string();
+        }
+
+        prepareJob(*job);
+        renameJobFile(*job, ".queued");
+        queue.push(job);
+        std::cout << "Queued job " << job->id << " (" << job->name << "), estimated cost "
+                  << job->estimatedCost << " iterations on "
+                  << (job->backend == RenderBackend::OpenCL ? "OpenCL" : "CPU") << std::endl;
+    }
+}
+
+void BatchRenderer::prepareJob(RenderJob& job) {
+    if (job.isZoomPath()) {
+        // Covers live on the tile grid, so zoom paths always render on CPU tiles
+        job.backend = RenderBackend::CpuTiles;
+        job.bandRows = 1;
+        job.bandCount = job.frames;
+
+        // An upper bound: tiles shared with earlier frames come from the cache
+        const int probes = std::min(job.frames, PATH_COST_PROBES);
+        const double framePixels = static_cast<double>(job.width) * job.height;
+        double cost = 0.0;
+        for (int i = 0; i < probes; ++i) {
+            const int frame = probes > 1 ? i * (job.frames - 1) / (probes - 1) : 0;
+            std::vector<double> zooms = ZoomPath::subFrameZooms(job.zoom, job.endZoom, job.frames, frame,
+                                                                job.motionBlurSamples, job.shutter);
+            double coverPixels = 0.0;
+            for (const ZoomPath::Cover& cover : ZoomPath::planCovers(job.centerX, job.centerY,
+                                                                     job.width, job.height, zooms)) {
+                coverPixels += static_cast<double>(cover.width) * cover.height;
+            }
+            CostEstimate estimate = estimator.estimate(job.centerX, job.centerY,
+                                                       ZoomPath::zoomAt(job.zoom, job.endZoom, job.frames, frame),
+                                                       job.maxIterations, job.width, job.height);
+            cost += estimate.totalIterations * coverPixels / framePixels;
+        }
+        job.estimatedCost = cost * job.frames / probes;
+        job.remainingCost = job.estimatedCost;
+        return;
+    }
+
+    CostEstimate estimate = estimator.estimate(job.centerX, job.centerY, job.zoom, job.maxIterations,
+                                               job.width, job.height);
+    job.estimatedCost = estimate.totalIterations;
+    job.remainingCost = job.estimatedCost;
+    // The OpenCL path only reads back colours
+    job.backend = job.rawOutput.empty() ? estimate.backend : RenderBackend::CpuTiles;
+
+    if (job.backend == RenderBackend::OpenCL) {
+        // One kernel launch renders the whole frame
+        job.bandRows = 1;
+        job.bandCount = 1;
+        return;
+    }
+
+    const double pixelSize = 4.0 / job.zoom / job.height;
+    const int64_t originX = std::llround(job.centerX / pixelSize) - job.width / 2;
+    const int64_t originY = std::llround(job.centerY / pixelSize) - job.height / 2;
+    const int tileRows = static_cast<int>(TileRenderer::tileIndex(originY + job.height - 1) -
+                                          TileRenderer::tileIndex(originY) + 1);
+    const int64_t tileColumns = TileRenderer::tileIndex(originX + job.width - 1) - TileRenderer::tileIndex(originX) + 1;
+    job.bandRows = static_cast<int>(std::min<int64_t>(estimator.suggestBandRows(estimate, job.height, BAND_TARGET_SECONDS),
+                                                      std::max<int64_t>(1, cacheTileBudget(cache) / tileColumns)));
+    job.bandCount = (tileRows + job.bandRows - 1) / job.bandRows;
+}
+
+void BatchRenderer::renderOpenCL(RenderJob& job) {
+    if (openclRenderer->getWidth() != job.width || openclRenderer->getHeight() != job.height) {
+        openclRenderer->resize(job.width, job.height);
+    }
+    openclRenderer->setMaxIterations(job.maxIterations);
+    openclRenderer->setColorMode(job.colorMode);
+    openclRenderer->setColorShift(job.colorShift);
+
+    auto start = std::chrono::steady_clock::now();
+    openclRenderer->computeFrame(job.centerX, job.centerY, job.zoom);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    estimator.calibrate(RenderBackend::OpenCL, job.estimatedCost, seconds);
+
+    const FrameVector<unsigned char>& frame = openclRenderer->getImageData();
+    job.image.assign(frame.begin(), frame.end());
+    job.nextBand = job.bandCount;
+    job.remainingCost = 0.0;
+}
+
+double BatchRenderer::waitForTiles(const std::vector<TileKey>& keys,
+                                   std::vector<std::shared_ptr<const TileIterations>>& tiles) {
+    size_t remaining = keys.size();
+    double iterations = 0.0;
+    std::vector<TileKey> missing;
+    while (remaining > 0) {
+        missing.clear();
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (tiles[i]) {
+                continue;
+            }
+            // Hold the decoded tile so eviction can't take it before it's coloured
+            tiles[i] = cache.find(keys[i]);
+            if (!tiles[i]) {
+                missing.push_back(keys[i]);
+                continue;
+            }
+            for (int iter : *tiles[i]) {
+                iterations += iter;
+            }
+            --remaining;
+        }
+        if (remaining > 0) {
+            // A tile evicted before it was picked up is rendered again only if resubmitted
+            if (!scheduler.unscheduled(clientId, missing).empty()) {
+                scheduler.submit(clientId, missing);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    return iterations;
+}
+
+void BatchRenderer::renderPathFrame(RenderJob& job) {
+    const int frame = job.nextBand;
+    const std::vector<double> zooms = ZoomPath::subFrameZooms(job.zoom, job.endZoom, job.frames, frame,
+                                                              job.motionBlurSamples, job.shutter);
+    std::vector<float> accumulator(static_cast<size_t>(job.width) * job.height * 3, 0.0f);
+    std::vector<unsigned char> tileRgb(TILE_SIZE * TILE_SIZE * 3);
+    std::vector<unsigned char> coverRgb;
+
+    for (const ZoomPath::Cover& cover : ZoomPath::planCovers(job.centerX, job.centerY,
+                                                             job.width, job.height, zooms)) {
+        const int64_t firstTileX = TileRenderer::tileIndex(cover.originX);
+        const int64_t lastTileX = TileRenderer::tileIndex(cover.originX + cover.width - 1);
+        const int64_t lastTileY = TileRenderer::tileIndex(cover.originY + cover.height - 1);
+        // A cover can be several frames' worth of tiles, more than the cache holds at once,
+        // so it is rendered and coloured a few tile rows at a time
+        const int64_t chunkRows = std::max<int64_t>(1, cacheTileBudget(cache) / (lastTileX - firstTileX + 1));
+        coverRgb.assign(static_cast<size_t>(cover.width) * cover.height * 3, 0);
+
+        for (int64_t chunkY = TileRenderer::tileIndex(cover.originY); chunkY <= lastTileY; chunkY += chunkRows) {
+            std::vector<TileKey> keys;
+            for (int64_t tileY = chunkY; tileY <= std::min(lastTileY, chunkY + chunkRows - 1); ++tileY) {
+                for (int64_t tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+                    keys.push_back(TileKey{cover.pixelSize, tileX, tileY, job.maxIterations});
+                }
+            }
+            const uint64_t renderedBefore = scheduler.getRenderedCount();
+            auto start = std::chrono::steady_clock::now();
+            scheduler.submit(clientId, keys);
+            std::vector<std::shared_ptr<const TileIterations>> tiles(keys.size());
+            const double chunkIterations = waitForTiles(keys, tiles);
+            if (scheduler.getRenderedCount() - renderedBefore == keys.size()) {
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                estimator.calibrate(RenderBackend::CpuTiles, chunkIterations, seconds);
+            }
+
+            for (size_t i = 0; i < keys.size(); ++i) {
+                TileRenderer::colorize(tiles[i]->data(), tiles[i]->size(), job.maxIterations,
+                                       job.colorMode, job.colorShift, tileRgb.data());
+                int x0, y0, x1, y1;
+                TileRenderer::copyTileToImage(tileRgb.data(), keys[i].tileX * TILE_SIZE - cover.originX,
+                                              keys[i].tileY * TILE_SIZE - cover.originY, coverRgb.data(),
+                                              cover.width, cover.height, x0, y0, x1, y1);
+            }
+        }
+        for (int s = cover.first; s < cover.first + cover.count; ++s) {
+            ZoomPath::accumulate(cover, coverRgb.data(), job.centerX, job.centerY, zooms[s],
+                                 job.width, job.height, accumulator.data());
+        }
+    }
+
+    job.image.resize(accumulator.size());
+    const float scale = 1.0f / zooms.size();
+    for (size_t i = 0; i < accumulator.size(); ++i) {
+        job.image[i] = static_cast<unsigned char>(std::min(accumulator[i] * scale + 0.5f, 255.0f));
+    }
+
+    const std::string filename = ZoomPath::frameFilename(job.output, frame);
+    if (!saveImagePng(filename, job.width, job.height, job.image.data())) {
+        // Give up on the rest of the path
+        job.failed = true;
+        job.nextBand = job.bandCount;
+        job.remainingCost = 0.0;
+        return;
+    }
+    ++job.nextBand;
+    job.remainingCost = job.estimatedCost * (job.bandCount - job.nextBand) / job.bandCount;
+}
+
+void BatchRenderer::renderBand(RenderJob& job) {
+    if (job.isZoomPath()) {
+        renderPathFrame(job);
+        return;
+    }
+    if (job.backend == RenderBackend::OpenCL) {
+        renderOpenCL(job);
+        return;
+    }
+
+    if (job.image.empty()) {
+        allocateImage(job);
+    }
+
+    // Same pixel grid as the interactive viewports so cached tiles are shared
+    const double pixelSize = 4.0 / job.zoom / job.height;
+    const int64_t originX = std::llround(job.centerX / pixelSize) - job.width / 2;
+    const int64_t originY = std::llround(job.centerY / pixelSize) - job.height / 2;
+    const int64_t firstTileY = TileRenderer::tileIndex(originY) + static_cast<int64_t>(job.nextBand) * job.bandRows;
+    const int64_t lastTileY = std::min(firstTileY + job.bandRows - 1,
+                                       TileRenderer::tileIndex(originY + job.height - 1));
+
+    std::vector<TileKey> band;
+    for (int64_t tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+        for (int64_t tileX = TileRenderer::tileIndex(originX);
+             tileX <= TileRenderer::tileIndex(originX + job.width - 1); ++tileX) {
+            band.push_back(TileKey{pixelSize, tileX, tileY, job.maxIterations});
+        }
+    }
+    const uint64_t renderedBefore = scheduler.getRenderedCount();
+    auto start = std::chrono::steady_clock::now();
+    scheduler.submit(clientId, band);
+
+    ColorTask task = {&job, band, std::vector<std::shared_ptr<const TileIterations>>(band.size()), originX, originY};
+    const double bandIterations = waitForTiles(band, task.tiles);
+
+    // Colouring overlaps the next band's rendering
+    {
+        std::lock_guard<std::mutex> lock(colorMutex);
+        ++job.colorTasksPending;
+        colorQueues[bandNode(job.nextBand)].push_back(std::move(task));
+    }
+    colorAvailable.notify_all();
+
+    // Tiles from the cache or the tile store would overstate the workers' throughput
+    if (scheduler.getRenderedCount() - renderedBefore == band.size()) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        estimator.calibrate(RenderBackend::CpuTiles, bandIterations, seconds);
+    }
+
+    ++job.nextBand;
+    job.remainingCost = job.estimatedCost * (job.bandCount - job.nextBand) / job.bandCount;
+}
+
+void BatchRenderer::finishJob(RenderJob& job) {
+    {
+        std::unique_lock<std::mutex> lock(colorMutex);
+        colorFinished.wait(lock, [&] { return job.colorTasksPending == 0; });
+    }
+
+    // Zoom-path frames were saved as they finished
+    bool saved = job.isZoomPath() ? !job.failed : saveImagePng(job.output, job.width, job.height, job.image.data());
+    if (saved && !job.rawOutput.empty()) {
+        saved = saveRawIterations(job);
+    }
+    if (saved) {
+        std::cout << "Finished job " << job.id << " (" << job.name << ") -> "
+                  << (job.isZoomPath() ? ZoomPath::frameFilename(job.output, 0) + " and on, " +
+                                         std::to_string(job.frames) + " frames"
+                                       : job.output) << std::endl;
+        renameJobFile(job, ".done");
+    } else {
+        renameJobFile(job, ".failed");
+    }
+    job.image.clear();
+    job.image.shrink_to_fit();
+    job.iterations.clear();
+    job.iterations.shrink_to_fit();
+}
+
+void BatchRenderer::run(bool exitWhenIdle) {
+    std::cout << "Batch renderer watching " << spoolDirectory << std::endl;
+
+    std::shared_ptr<RenderJob> current;
+    auto lastScan = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastScan >= std::chrono::milliseconds(500)) {
+            scanSpool();
+            lastScan = now;
+        }
+
+        // Preempt between bands when something more urgent or shorter is waiting
+        if (current && queue.shouldPreempt(*current)) {
+            std::cout << "Preempting job " << current->id << " at band "
+                      << current->nextBand << "/" << current->bandCount << std::endl;
+            queue.push(current);
+            current.reset();
+        }
+        if (!current) {
+            current = queue.pop();
+        }
+
+        if (!current) {
+            if (exitWhenIdle) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            continue;
+        }
+
+        renderBand(*current);
+        if (current->nextBand >= current->bandCount) {
+            finishJob(*current);
+            current.reset();
+        }
+    }
+}
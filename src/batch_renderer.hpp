@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cost_estimator.hpp"
+#include "job_queue.hpp"
+#include "mandelbrot.hpp"
+#include "render_scheduler.hpp"
+
+// Headless renderer for jobs submitted through a spool directory.
+// Each *.job file (key=value lines, see parseRenderJob) is picked up and renamed to
+// .queued, then to .done or .failed. Jobs render one band of tiles at a time and yield
+// to any better job that arrives in between, so thumbnails never wait behind exports.
+// A probe of each job picks its backend and band height and gives its queue cost.
+// Finished bands are coloured by one thread per NUMA node while the next band renders;
+// each band's rows of the image are placed on the node of the thread that colours it.
+// Zoom-path jobs render one frame per band, resampling motion blur sub-frames from
+// shared covers on the tile grid (see ZoomPath) and saving each frame as it finishes.
+class BatchRenderer {
+public:
+    BatchRenderer(const std::string& spoolDirectory, RenderScheduler& scheduler, TileCache& cache);
+    ~BatchRenderer();
+
+    BatchRenderer(const BatchRenderer&) = delete;
+    BatchRenderer& operator=(const BatchRenderer&) = delete;
+
+    // Processes jobs until the spool is empty (exitWhenIdle) or forever
+    void run(bool exitWhenIdle);
+
+private:
+    void scanSpool();
+    void prepareJob(RenderJob& job);
+    void renderBand(RenderJob& job);
+    void renderOpenCL(RenderJob& job);
+    void renderPathFrame(RenderJob& job);
+    void finishJob(RenderJob& job);
+
+    // A rendered band waiting to be coloured into its job's image
+    struct ColorTask {
+        RenderJob* job;
+        std::vector<TileKey> keys;
+        std::vector<std::shared_ptr<const TileIterations>> tiles;
+        int64_t originX;
+        int64_t originY;
+    };
+
+    // Waits until every tile is in the cache and holds it there, submitting again any the
+    // cache evicted before they were picked up; returns their total iterations
+    double waitForTiles(const std::vector<TileKey>& keys, std::vector<std::shared_ptr<const TileIterations>>& tiles);
+    void allocateImage(RenderJob& job);
+    int bandNode(int band) const;
+    void colorLoop(int node);
+
+    std::string spoolDirectory;
+    RenderScheduler& scheduler;
+    TileCache& cache;
+    int clientId;
+    int nextJobId;
+    JobQueue queue;
+    CostEstimator estimator;
+    std::unique_ptr<MandelbrotViewer> openclRenderer;  // Null if OpenCL is unavailable
+
+    std::vector<std::thread> colorThreads;
+    std::vector<std::deque<ColorTask>> colorQueues;  // One per node
+    std::mutex colorMutex;
+    std::condition_variable colorAvailable;
+    std::condition_variable colorFinished;
+    bool stopping;
+};
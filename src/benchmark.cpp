@@ -0,0 +1,366 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include "mandelbrot.hpp"
+#include "tile_renderer.hpp"
+#include "tile_cache.hpp"
+#include "render_scheduler.hpp"
+#include "cpu_topology.hpp"
+#include "frame_memory.hpp"
+#include "perf_counters.hpp"
+
+// Fixed set of views covering escape-heavy, boundary-heavy and interior-heavy frames
+struct BenchmarkView {
+    const char* name;
+    double centerX;
+    double centerY;
+    double zoom;
+    int maxIterations;
+};
+
+const BenchmarkView BENCHMARK_VIEWS[] = {
+    {"full-set", -0.5, 0.0, 1.0, 200},
+    {"seahorse-valley", -0.745, 0.113, 50.0, 1000},
+    {"elephant-valley", 0.282, 0.01, 100.0, 800},
+    {"interior-heavy", -0.2, 0.0, 3.0, 2000},
+};
+
+struct BenchmarkOptions {
+    int width = 800;
+    int height = 600;
+    int repeat = 3;
+    int exportScale = 4;
+    bool perf = false;
+    bool cpu = true;
+    bool opencl = true;
+};
+
+struct StageResult {
+    double seconds;
+    PerfSample counters;
+};
+
+// Runs a stage `repeat` times and keeps the fastest run together with its counters
+template <typename StageFn>
+StageResult measureStage(PerfCounters* counters, int repeat, StageFn stage) {
+    StageResult best = {0.0, PerfSample{false, 0, 0, 0, 0}};
+    for (int run = 0; run < repeat; ++run) {
+        if (counters) counters->start();
+        auto start = std::chrono::steady_clock::now();
+        stage();
+        auto end = std::chrono::steady_clock::now();
+        PerfSample sample = counters ? counters->stop() : PerfSample{false, 0, 0, 0, 0};
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        if (run == 0 || seconds < best.seconds) {
+            best.seconds = seconds;
+            best.counters = sample;
+        }
+    }
+    return best;
+}
+
+void printHeader(bool perf) {
+    std::cout << std::left << std::setw(10) << "backend" << std::setw(10) << "stage"
+              << std::setw(18) << "view" << std::right << std::setw(10) << "ms"
+              << std::setw(10) << "Mpix/s";
+    if (perf) {
+        std::cout << std::setw(14) << "instructions" << std::setw(14) << "cycles"
+                  << std::setw(7) << "IPC" << std::setw(12) << "cache-miss"
+                  << std::setw(12) << "branch-miss";
+    }
+    std::cout << std::endl;
+}
+
+void printResult(const char* backend, const char* stage, const BenchmarkView& view,
+                 size_t pixels, const StageResult& result, bool perf) {
+    std::cout << std::left << std::setw(10) << backend << std::setw(10) << stage
+              << std::setw(18) << view.name << std::right << std::fixed
+              << std::setw(10) << std::setprecision(2) << result.seconds * 1000.0
+              << std::setw(10) << std::setprecision(1) << pixels / result.seconds / 1.0e6;
+    if (perf) {
+        if (result.counters.valid) {
+            std::cout << std::setw(14) << result.counters.instructions
+                      << std::setw(14) << result.counters.cycles
+                      << std::setw(7) << std::setprecision(2) << result.counters.ipc()
+                      << std::setw(12) << result.counters.cacheMisses
+                      << std::setw(12) << result.counters.branchMisses;
+        } else {
+            std::cout << std::setw(14) << "n/a";
+        }
+    }
+    std::cout << std::endl;
+}
+
+// Tiles covering a width x height frame of the view, using the viewport's pixel grid
+std::vector<TileKey> frameTiles(const BenchmarkView& view, int width, int height) {
+    double pixelSize = 4.0 / view.zoom / height;
+    int64_t originX = std::llround(view.centerX / pixelSize) - width / 2;
+    int64_t originY = std::llround(view.centerY / pixelSize) - height / 2;
+
+    std::vector<TileKey> tiles;
+    for (int64_t ty = TileRenderer::tileIndex(originY); ty <= TileRenderer::tileIndex(originY + height - 1); ++ty) {
+        for (int64_t tx = TileRenderer::tileIndex(originX); tx <= TileRenderer::tileIndex(originX + width - 1); ++tx) {
+            tiles.push_back(TileKey{pixelSize, tx, ty, view.maxIterations});
+        }
+    }
+    return tiles;
+}
+
+// Colour pass over an export frame `scale` times the benchmark size, built by upscaling
+// the view's tiles. The same node-pinned threads colour the same rows twice: once with
+// every page on node 0, once with each thread's rows on its own node.
+void benchmarkPlacement(const BenchmarkView& view, const std::vector<TileKey>& tiles,
+                        const std::vector<TileIterations>& iterations, const BenchmarkOptions& options,
+                        PerfCounters* counters) {
+    const int64_t firstTileX = tiles.front().tileX;
+    const int64_t firstTileY = tiles.front().tileY;
+    const int tilesX = static_cast<int>(tiles.back().tileX - firstTileX + 1);
+    const int width = tilesX * TILE_SIZE * options.exportScale;
+    const int height = static_cast<int>(tiles.back().tileY - firstTileY + 1) * TILE_SIZE * options.exportScale;
+    const size_t pixels = static_cast<size_t>(width) * height;
+
+    const int nodeCount = static_cast<int>(CpuTopology::nodes().size());
+    int threadCount = 0;
+    for (const CpuTopology::Node& node : CpuTopology::nodes()) {
+        threadCount += static_cast<int>(node.cpus.size());
+    }
+
+    // Runs fn(thread, firstRow, lastRow) on threadCount threads pinned round-robin to nodes
+    auto forEachChunk = [&](auto fn) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&, t] {
+                CpuTopology::pinCurrentThreadToNode(t % nodeCount);
+                fn(t, static_cast<int>(static_cast<int64_t>(height) * t / threadCount),
+                   static_cast<int>(static_cast<int64_t>(height) * (t + 1) / threadCount));
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    };
+
+    for (bool local : {false, true}) {
+        FrameVector<int> exportIterations(pixels);
+        FrameVector<unsigned char> rgb(pixels * 3);
+        forEachChunk([&](int t, int rowBegin, int rowEnd) {
+            int node = local ? t % nodeCount : 0;
+            size_t first = static_cast<size_t>(rowBegin) * width;
+            size_t count = static_cast<size_t>(rowEnd - rowBegin) * width;
+            CpuTopology::bindMemory(exportIterations.data() + first, count * sizeof(int), node);
+            CpuTopology::bindMemory(rgb.data() + first * 3, count * 3, node);
+
+            // Nearest-neighbour upscale of the rendered tiles; also places the pages
+            for (int y = rowBegin; y < rowEnd; ++y) {
+                int sourceY = y / options.exportScale;
+                for (int x = 0; x < width; ++x) {
+                    int sourceX = x / options.exportScale;
+                    const TileIterations& tile = iterations[(sourceY / TILE_SIZE) * tilesX + sourceX / TILE_SIZE];
+                    exportIterations[static_cast<size_t>(y) * width + x] =
+                        tile[(sourceY % TILE_SIZE) * TILE_SIZE + sourceX % TILE_SIZE];
+                }
+                std::fill(rgb.begin() + static_cast<size_t>(y) * width * 3,
+                          rgb.begin() + static_cast<size_t>(y + 1) * width * 3, 0);
+            }
+        });
+
+        StageResult color = measureStage(counters, options.repeat, [&] {
+            forEachChunk([&](int, int rowBegin, int rowEnd) {
+                size_t first = static_cast<size_t>(rowBegin) * width;
+                TileRenderer::colorize(exportIterations.data() + first, static_cast<size_t>(rowEnd - rowBegin) * width,
+                                       view.maxIterations, 1, 1.8, rgb.data() + first * 3);
+            });
+        });
+        printResult("export", local ? "per-node" : "one-node", view, pixels, color, options.perf);
+    }
+}
+
+// Single-threaded colour pass over the same export frame: every tile is coloured and
+// copied into place, as the batch renderer does. Each 64-row tile copy touches 64
+// different 4 KB pages of a wide frame but usually one 2 MB page, so this shows the
+// TLB cost of each huge page mode.
+void benchmarkHugePages(const BenchmarkView& view, const std::vector<TileKey>& tiles,
+                        const std::vector<TileIterations>& iterations, const BenchmarkOptions& options,
+                        PerfCounters* counters) {
+    const int tilesX = static_cast<int>(tiles.back().tileX - tiles.front().tileX + 1);
+    const int tilesY = static_cast<int>(tiles.back().tileY - tiles.front().tileY + 1);
+    const int width = tilesX * TILE_SIZE * options.exportScale;
+    const int height = tilesY * TILE_SIZE * options.exportScale;
+    const size_t pixels = static_cast<size_t>(width) * height;
+
+    const FrameMemory::HugePages previous = FrameMemory::getHugePages();
+    const FrameMemory::HugePages modes[] = {FrameMemory::HugePages::Off, FrameMemory::HugePages::Transparent,
+                                            FrameMemory::HugePages::Explicit};
+    const char* stageNames[] = {"4k", "thp", "hugetlb"};
+    std::vector<unsigned char> tileRgb(TILE_SIZE * TILE_SIZE * 3);
+    for (int m = 0; m < 3; ++m) {
+        const FrameMemory::HugePages mode = modes[m];
+        FrameMemory::setHugePages(mode);
+        FrameVector<unsigned char> image(pixels * 3);
+        std::fill(image.begin(), image.end(), 0);
+
+        StageResult color = measureStage(counters, options.repeat, [&] {
+            for (int ty = 0; ty < tilesY * options.exportScale; ++ty) {
+                for (int tx = 0; tx < tilesX * options.exportScale; ++tx) {
+                    const TileIterations& tile = iterations[(ty / options.exportScale) * tilesX + tx / options.exportScale];
+                    TileRenderer::colorize(tile.data(), tile.size(), view.maxIterations, 1, 1.8, tileRgb.data());
+                    int x0, y0, x1, y1;
+                    TileRenderer::copyTileToImage(tileRgb.data(), tx * TILE_SIZE, ty * TILE_SIZE, image.data(),
+                                                  width, height, x0, y0, x1, y1);
+                }
+            }
+        });
+        printResult("pages", stageNames[m], view, pixels, color, options.perf);
+    }
+    FrameMemory::setHugePages(previous);
+}
+
+void benchmarkCpu(const BenchmarkView& view, const BenchmarkOptions& options, PerfCounters* counters) {
+    std::vector<TileKey> tiles = frameTiles(view, options.width, options.height);
+    const size_t pixels = tiles.size() * TILE_SIZE * TILE_SIZE;
+    std::vector<TileIterations> iterations(tiles.size(), TileIterations(TILE_SIZE * TILE_SIZE));
+    std::vector<unsigned char> rgb(TILE_SIZE * TILE_SIZE * 3);
+
+    StageResult iterate = measureStage(counters, options.repeat, [&] {
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            TileRenderer::computeIterations(tiles[i], iterations[i].data());
+        }
+    });
+    printResult("cpu", "iterate", view, pixels, iterate, options.perf);
+
+    // One pixel at a time, for comparison with the batched structure-of-arrays kernel
+    StageResult scalar = measureStage(counters, options.repeat, [&] {
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            const TileKey& key = tiles[i];
+            for (int y = 0; y < TILE_SIZE; ++y) {
+                double y0 = static_cast<double>(key.tileY * TILE_SIZE + y) * key.pixelSize;
+                for (int x = 0; x < TILE_SIZE; ++x) {
+                    double x0 = static_cast<double>(key.tileX * TILE_SIZE + x) * key.pixelSize;
+                    iterations[i][y * TILE_SIZE + x] = TileRenderer::escapeIterations(x0, y0, key.maxIterations);
+                }
+            }
+        }
+    });
+    printResult("cpu", "scalar", view, pixels, scalar, options.perf);
+
+    StageResult color = measureStage(counters, options.repeat, [&] {
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            TileRenderer::colorize(iterations[i].data(), iterations[i].size(), view.maxIterations,
+                                   1, 1.8, rgb.data());
+        }
+    });
+    printResult("cpu", "color", view, pixels, color, options.perf);
+
+    // Scheduler workers are created and joined inside the stage so their counters are included
+    double utilization = 0.0;
+    uint64_t stolen = 0;
+    int workerCount = 0;
+    StageResult scheduled = measureStage(counters, options.repeat, [&] {
+        TileCache cache(tiles.size() * TILE_SIZE * TILE_SIZE * sizeof(int));
+        RenderScheduler scheduler(cache);
+        int client = scheduler.addClient();
+        scheduler.submit(client, tiles);
+        while (scheduler.getPendingCount() > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        // Worst run, so a single lucky frame can't hide load imbalance
+        double runUtilization = scheduler.getUtilization();
+        if (workerCount == 0 || runUtilization < utilization) {
+            utilization = runUtilization;
+            stolen = scheduler.getStolenCount();
+        }
+        workerCount = scheduler.getWorkerCount();
+    });
+    printResult("cpu-mt", "iterate", view, pixels, scheduled, options.perf);
+    std::cout << "          " << workerCount << " workers, " << std::setprecision(1)
+              << utilization * 100.0 << "% utilization, " << stolen << " jobs stolen" << std::endl;
+
+    benchmarkPlacement(view, tiles, iterations, options, counters);
+    benchmarkHugePages(view, tiles, iterations, options, counters);
+}
+
+void benchmarkOpenCL(MandelbrotViewer& viewer, const BenchmarkView& view,
+                     const BenchmarkOptions& options, PerfCounters* counters) {
+    const size_t pixels = static_cast<size_t>(options.width) * options.height;
+    viewer.setMaxIterations(view.maxIterations);
+
+    // Counters only see the host side: argument setup, transfers and waiting on the device
+    StageResult frame = measureStage(counters, options.repeat, [&] {
+        viewer.computeFrame(view.centerX, view.centerY, view.zoom);
+    });
+    printResult("opencl", "frame", view, pixels, frame, options.perf);
+}
+
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl
+              << "  --width N        Frame width (default 800)" << std::endl
+              << "  --height N       Frame height (default 600)" << std::endl
+              << "  --repeat N       Runs per stage, fastest is reported (default 3)" << std::endl
+              << "  --backend NAME   cpu, opencl or all (default all)" << std::endl
+              << "  --export-scale N Export frame size for the placement and page stages, in benchmark frames (default 4)" << std::endl
+              << "  --perf           Collect hardware performance counters (Linux)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--perf") {
+            options.perf = true;
+        } else if (arg == "--width" && i + 1 < argc) {
+            options.width = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--height" && i + 1 < argc) {
+            options.height = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            options.repeat = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--export-scale" && i + 1 < argc) {
+            options.exportScale = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--backend" && i + 1 < argc) {
+            std::string backend = argv[++i];
+            options.cpu = backend == "cpu" || backend == "all";
+            options.opencl = backend == "opencl" || backend == "all";
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // Counters must exist before any worker thread is started to inherit into it
+    std::unique_ptr<PerfCounters> counters;
+    if (options.perf) {
+        counters.reset(new PerfCounters());
+        if (!counters->isAvailable()) {
+            counters.reset();
+        }
+    }
+
+    std::unique_ptr<MandelbrotViewer> viewer;
+    if (options.opencl) {
+        try {
+            viewer.reset(new MandelbrotViewer(options.width, options.height, 200, 1, 1.8));
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Skipping OpenCL backend: " << e.what() << std::endl;
+        }
+    }
+
+    std::cout << "Benchmark " << options.width << "x" << options.height
+              << ", best of " << options.repeat << " runs" << std::endl;
+    printHeader(options.perf);
+
+    for (const BenchmarkView& view : BENCHMARK_VIEWS) {
+        if (options.cpu) {
+            benchmarkCpu(view, options, counters.get());
+        }
+        if (viewer) {
+            benchmarkOpenCL(*viewer, view, options, counters.get());
+        }
+    }
+    return 0;
+}
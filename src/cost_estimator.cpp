@@ -0,0 +1,146 @@
+#include "cost_estimator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "tile_renderer.hpp"
+
+// Starting throughput before any calibration, deliberately on the slow side
+const double DEFAULT_CPU_ITERATIONS_PER_SECOND = 2.0e8;
+const double DEFAULT_OPENCL_ITERATIONS_PER_SECOND = 2.0e9;
+
+// Fixed OpenCL cost per frame for kernel launches and synchronisation
+const double OPENCL_LAUNCH_SECONDS = 0.002;
+
+// Weight of a new measurement in the running throughput
+const double CALIBRATION_WEIGHT = 0.3;
+
+// Probes too small to time reliably are not used for calibration
+const double MIN_CALIBRATION_SECONDS = 0.0005;
+
+CostEstimator::CostEstimator(int cpuThreads, bool openclAvailable)
+    : cpuThreads(std::max(1, cpuThreads)), openclAvailable(openclAvailable),
+      cpuIterationsPerSecond(DEFAULT_CPU_ITERATIONS_PER_SECOND),
+      openclIterationsPerSecond(DEFAULT_OPENCL_ITERATIONS_PER_SECOND)
+{
+}
+
+int CostEstimator::probe(double centerX, double centerY, double zoom, int maxIterations,
+                         int width, int height, std::vector<int>& iterations) {
+    const int probeWidth = std::min(PROBE_WIDTH, width);
+    const int probeHeight = std::max(1, static_cast<int>(std::lround(static_cast<double>(probeWidth) * height / width)));
+    const double pixelSize = 4.0 / zoom / height;
+    const double stepX = static_cast<double>(width) / probeWidth;
+    const double stepY = static_cast<double>(height) / probeHeight;
+
+    iterations.resize(static_cast<size_t>(probeWidth) * probeHeight);
+    double probeIterations = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (int py = 0; py < probeHeight; ++py) {
+        // Sample the centre of the block of frame pixels each probe pixel stands for
+        double y0 = centerY + ((py + 0.5) * stepY - height / 2.0) * pixelSize;
+        for (int px = 0; px < probeWidth; ++px) {
+            double x0 = centerX + ((px + 0.5) * stepX - width / 2.0) * pixelSize;
+            int iter = TileRenderer::escapeIterations(x0, y0, maxIterations);
+            iterations[py * probeWidth + px] = iter;
+            probeIterations += iter;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // The probe runs the same loop as a tile worker, so it doubles as a CPU measurement
+    if (seconds >= MIN_CALIBRATION_SECONDS && probeIterations > 0.0) {
+        cpuIterationsPerSecond += CALIBRATION_WEIGHT * (probeIterations / seconds - cpuIterationsPerSecond);
+    }
+    return probeWidth * probeHeight;
+}
+
+CostEstimate CostEstimator::estimate(double centerX, double centerY, double zoom, int maxIterations,
+                                     int width, int height) {
+    std::vector<int> iterations;
+    int probePixels = probe(centerX, centerY, zoom, maxIterations, width, height, iterations);
+
+    double sum = 0.0;
+    int interior = 0;
+    std::vector<int> escaped;
+    escaped.reserve(iterations.size());
+    for (int iter : iterations) {
+        sum += iter;
+        if (iter >= maxIterations) {
+            ++interior;
+        } else {
+            escaped.push_back(iter);
+        }
+    }
+
+    CostEstimate result;
+    const double pixels = static_cast<double>(width) * height;
+    result.totalIterations = sum / probePixels * pixels;
+    result.interiorFraction = static_cast<double>(interior) / probePixels;
+    if (!escaped.empty()) {
+        size_t rank = std::min(escaped.size() - 1, escaped.size() * 99 / 100);
+        std::nth_element(escaped.begin(), escaped.begin() + rank, escaped.end());
+        result.escapeP99 = escaped[rank];
+    }
+
+    fillSeconds(result);
+    return result;
+}
+
+CostEstimate CostEstimator::estimateCapped(double centerX, double centerY, double zoom, int maxIterations,
+                                           int width, int height, int probeIterations) {
+    if (maxIterations <= probeIterations) {
+        return estimate(centerX, centerY, zoom, maxIterations, width, height);
+    }
+    CostEstimate result = estimate(centerX, centerY, zoom, probeIterations, width, height);
+    const double pixels = static_cast<double>(width) * height;
+    result.totalIterations += result.interiorFraction * pixels * (maxIterations - probeIterations);
+    fillSeconds(result);
+    return result;
+}
+
+void CostEstimator::fillSeconds(CostEstimate& estimate) const {
+    estimate.cpuSeconds = estimate.totalIterations / (cpuIterationsPerSecond * cpuThreads);
+    estimate.openclSeconds = OPENCL_LAUNCH_SECONDS + estimate.totalIterations / openclIterationsPerSecond;
+    estimate.backend = openclAvailable && estimate.openclSeconds < estimate.cpuSeconds ?
+                       RenderBackend::OpenCL : RenderBackend::CpuTiles;
+}
+
+int CostEstimator::suggestMaxIterations(double centerX, double centerY, double zoom,
+                                        int width, int height, int minIterations, int maxIterations) {
+    CostEstimate probed = estimate(centerX, centerY, zoom, maxIterations, width, height);
+
+    // Nothing escaped below the cap: either deep interior or detail beyond the cap
+    if (probed.escapeP99 == 0 && probed.interiorFraction > 0.0) {
+        return maxIterations;
+    }
+
+    // Headroom over the slowest escaping pixels, rounded so small pans don't flicker the limit
+    int suggested = (probed.escapeP99 * 2 + 99) / 100 * 100;
+    return std::min(std::max(suggested, minIterations), maxIterations);
+}
+
+int CostEstimator::suggestBandRows(const CostEstimate& estimate, int height, double targetSeconds) const {
+    int tileRows = (height + TILE_SIZE - 1) / TILE_SIZE + 1;
+    double secondsPerRow = estimate.cpuSeconds / tileRows;
+    if (secondsPerRow <= 0.0) {
+        return tileRows;
+    }
+    int rows = static_cast<int>(targetSeconds / secondsPerRow);
+    return std::min(std::max(rows, 1), tileRows);
+}
+
+void CostEstimator::calibrate(RenderBackend backend, double iterations, double seconds) {
+    if (seconds < MIN_CALIBRATION_SECONDS || iterations <= 0.0) {
+        return;
+    }
+
+    if (backend == RenderBackend::CpuTiles) {
+        double measured = iterations / seconds / cpuThreads;
+        cpuIterationsPerSecond += CALIBRATION_WEIGHT * (measured - cpuIterationsPerSecond);
+    } else {
+        // Launch overhead is modelled separately
+        double kernelSeconds = std::max(seconds - OPENCL_LAUNCH_SECONDS, MIN_CALIBRATION_SECONDS);
+        double measured = iterations / kernelSeconds;
+        openclIterationsPerSecond += CALIBRATION_WEIGHT * (measured - openclIterationsPerSecond);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+enum class RenderBackend {
+    CpuTiles,
+    OpenCL
+};
+
+struct CostEstimate {
+    double totalIterations = 0.0;   // Extrapolated to the full frame
+    double interiorFraction = 0.0;  // Probe pixels that reached maxIterations
+    int escapeP99 = 0;              // 99th percentile iteration count of escaped probe pixels
+    double cpuSeconds = 0.0;        // On all tile workers
+    double openclSeconds = 0.0;
+    RenderBackend backend = RenderBackend::CpuTiles;  // Faster of the two
+};
+
+// Predicts the cost of a view from a low-resolution probe (64 pixels wide, same aspect
+// as the frame) rendered on the calling thread. Iteration counts extrapolate to the full
+// frame; wall time per backend comes from measured throughput, which starts at a
+// conservative default and is refined by calibrate() as real renders complete.
+class CostEstimator {
+public:
+    static const int PROBE_WIDTH = 64;
+
+    explicit CostEstimator(int cpuThreads = 1, bool openclAvailable = false);
+
+    CostEstimate estimate(double centerX, double centerY, double zoom, int maxIterations,
+                          int width, int height);
+
+    // Same for limits too high to probe directly: the probe stops at probeIterations and
+    // pixels still running then are assumed to run to maxIterations
+    CostEstimate estimateCapped(double centerX, double centerY, double zoom, int maxIterations,
+                                int width, int height, int probeIterations);
+
+    // Smallest iteration limit in [minIterations, maxIterations] that resolves nearly all
+    // escaping pixels of the view
+    int suggestMaxIterations(double centerX, double centerY, double zoom,
+                             int width, int height, int minIterations, int maxIterations);
+
+    // Tile rows to render between preemption checks so each band takes about targetSeconds
+    int suggestBandRows(const CostEstimate& estimate, int height, double targetSeconds) const;
+
+    // Feeds a measured render back into the backend's throughput: total iterations of
+    // the frame and its wall time (on all tile workers for the CPU backend)
+    void calibrate(RenderBackend backend, double iterations, double seconds);
+
+    void setOpenCLAvailable(bool available) { openclAvailable = available; }
+    double getCpuIterationsPerSecond() const { return cpuIterationsPerSecond; }
+    double getOpenCLIterationsPerSecond() const { return openclIterationsPerSecond; }
+
+private:
+    // Per-backend wall times and the faster backend from totalIterations
+    void fillSeconds(CostEstimate& estimate) const;
+
+    // Iteration counts of the probe grid; returns the probe's pixel count
+    int probe(double centerX, double centerY, double zoom, int maxIterations,
+              int width, int height, std::vector<int>& iterations);
+
+    int cpuThreads;
+    bool openclAvailable;
+    double cpuIterationsPerSecond;     // Per thread
+    double openclIterationsPerSecond;
+};
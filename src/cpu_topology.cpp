@@ -0,0 +1,192 @@
+#include "cpu_topology.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace CpuTopology {
+
+namespace {
+
+// Parses sysfs CPU lists such as "0-3,8-11"
+std::vector<int> parseCpuList(const std::string& text) {
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        try {
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            // Trailing newline or malformed entry
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        int count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int cpu = 0; cpu < count; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<Node> readNodes() {
+    std::vector<int> allowed = allowedCpus();
+    std::vector<Node> found;
+
+#ifdef __linux__
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string onlineText;
+    if (std::getline(online, onlineText)) {
+        for (int node : parseCpuList(onlineText)) {
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string listText;
+            if (!std::getline(list, listText)) {
+                continue;
+            }
+            std::vector<int> cpus;
+            for (int cpu : parseCpuList(listText)) {
+                if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+                    cpus.push_back(cpu);
+                }
+            }
+            // Memory-only nodes and nodes outside our affinity mask have nothing to run on
+            if (!cpus.empty()) {
+                found.push_back({node, cpus});
+            }
+        }
+    }
+#endif
+
+    if (found.empty()) {
+        found.push_back({0, allowed});
+    }
+    return found;
+}
+
+} // namespace
+
+const std::vector<Node>& nodes() {
+    static const std::vector<Node> topology = readNodes();
+    return topology;
+}
+
+std::vector<WorkerPlacement> placeWorkers(int workerCount) {
+    const std::vector<Node>& topology = nodes();
+    size_t cpuCount = 0;
+    for (const Node& node : topology) {
+        cpuCount += node.cpus.size();
+    }
+
+    std::vector<WorkerPlacement> placements;
+    std::vector<size_t> nextCpu(topology.size(), 0);
+    size_t node = 0;
+    for (int i = 0; i < workerCount; ++i) {
+        // Skip nodes whose CPUs are all taken
+        while (static_cast<size_t>(i) < cpuCount && nextCpu[node] >= topology[node].cpus.size()) {
+            node = (node + 1) % topology.size();
+        }
+        if (static_cast<size_t>(i) < cpuCount) {
+            placements.push_back({topology[node].cpus[nextCpu[node]++], static_cast<int>(node)});
+        } else {
+            // More workers than CPUs: let the OS schedule the extras
+            placements.push_back({-1, static_cast<int>(node)});
+        }
+        node = (node + 1) % topology.size();
+    }
+    return placements;
+}
+
+bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+bool pinCurrentThreadToNode(int node) {
+    const std::vector<Node>& topology = nodes();
+    if (node < 0 || node >= static_cast<int>(topology.size())) {
+        return false;
+    }
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : topology[node].cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+bool bindMemory(void* memory, size_t bytes, int node) {
+    const std::vector<Node>& topology = nodes();
+    if (node < 0 || node >= static_cast<int>(topology.size())) {
+        return false;
+    }
+#if defined(__linux__) && defined(SYS_mbind)
+    const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t begin = (reinterpret_cast<uintptr_t>(memory) + pageSize - 1) & ~(pageSize - 1);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(memory) + bytes) & ~(pageSize - 1);
+    if (end <= begin) {
+        return false;
+    }
+
+    // MPOL_PREFERRED rather than MPOL_BIND, so a full node spills over instead of failing
+    const int MPOL_PREFERRED_MODE = 1;
+    const int id = topology[node].id;
+    const unsigned long bitsPerWord = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask(id / bitsPerWord + 1, 0);
+    mask[id / bitsPerWord] = 1UL << (id % bitsPerWord);
+    // The kernel drops the last bit of maxnode, hence the + 1
+    return syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED_MODE, mask.data(),
+                   mask.size() * bitsPerWord + 1, 0) == 0;
+#else
+    (void)memory;
+    (void)bytes;
+    return false;
+#endif
+}
+
+} // namespace CpuTopology
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Which CPUs the process may run on and which NUMA node each belongs to, so render
+// workers can be pinned evenly across nodes and steal from their neighbours first, and
+// frame buffers can be placed on the node that writes them.
+// Outside Linux, or when sysfs is unavailable, every CPU is reported on one node and
+// pinning and binding are no-ops.
+namespace CpuTopology {
+    struct Node {
+        int id;  // Kernel node number
+        std::vector<int> cpus;
+    };
+
+    struct WorkerPlacement {
+        int cpu;   // -1 when the worker should not be pinned
+        int node;  // Index into nodes()
+    };
+
+    // Nodes with CPUs this process may run on; read once, never empty
+    const std::vector<Node>& nodes();
+
+    // Spreads workers over the nodes round-robin, one CPU each while CPUs last
+    std::vector<WorkerPlacement> placeWorkers(int workerCount);
+
+    // Pins the calling thread to one CPU; false if unsupported or refused
+    bool pinCurrentThread(int cpu);
+
+    // Lets the calling thread run on any CPU of a node (index into nodes())
+    bool pinCurrentThreadToNode(int node);
+
+    // Places the whole pages inside [memory, memory + bytes) on a node (index into
+    // nodes()), falling back to other nodes when it is out of memory. Pages already
+    // touched are left where they are.
+    bool bindMemory(void* memory, size_t bytes, int node);
+}
@@ -0,0 +1,170 @@
+#include "frame_memory.hpp"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace FrameMemory {
+
+namespace {
+
+const size_t HUGE_PAGE_BYTES = 2 << 20;
+
+std::atomic<HugePages> hugePageMode(HugePages::Transparent);
+std::atomic<bool> explicitFallbackReported(false);
+
+// Where each large block's mapping really starts and ends; alignment and huge page
+// rounding make it differ from the block the caller sees
+struct Mapping {
+    void* base;
+    size_t bytes;
+};
+std::mutex mappingsMutex;
+std::unordered_map<void*, Mapping> mappings;
+
+size_t roundUp(size_t bytes, size_t granularity) {
+    return (bytes + granularity - 1) / granularity * granularity;
+}
+
+#ifndef _WIN32
+void* mapAnonymous(size_t bytes, int extraFlags) {
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+    return memory == MAP_FAILED ? nullptr : memory;
+}
+
+#if defined(MADV_HUGEPAGE)
+// Maps extra and trims both ends so the block starts on a huge page boundary
+void* mapTransparent(size_t bytes, Mapping& mapping) {
+    size_t rounded = roundUp(bytes, HUGE_PAGE_BYTES);
+    unsigned char* raw = static_cast<unsigned char*>(mapAnonymous(rounded + HUGE_PAGE_BYTES, 0));
+    if (!raw) {
+        return nullptr;
+    }
+    uintptr_t address = reinterpret_cast<uintptr_t>(raw);
+    unsigned char* aligned = raw + (roundUp(address, HUGE_PAGE_BYTES) - address);
+    size_t head = aligned - raw;
+    size_t tail = HUGE_PAGE_BYTES - head;
+    if (head > 0) {
+        munmap(raw, head);
+    }
+    if (tail > 0) {
+        munmap(aligned + rounded, tail);
+    }
+    // Only advice: without THP support the block still works with small pages
+    madvise(aligned, rounded, MADV_HUGEPAGE);
+    mapping = {aligned, rounded};
+    return aligned;
+}
+#endif
+#endif
+
+} // namespace
+
+void setHugePages(HugePages mode) {
+    hugePageMode = mode;
+}
+
+HugePages getHugePages() {
+    return hugePageMode;
+}
+
+bool parseHugePages(const std::string& name, HugePages& mode) {
+    if (name == "off") {
+        mode = HugePages::Off;
+    } else if (name == "transparent") {
+        mode = HugePages::Transparent;
+    } else if (name == "explicit") {
+        mode = HugePages::Explicit;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* hugePagesName(HugePages mode) {
+    switch (mode) {
+        case HugePages::Off: return "off";
+        case HugePages::Transparent: return "transparent";
+        case HugePages::Explicit: return "explicit";
+    }
+    return "off";
+}
+
+void* allocate(size_t bytes) {
+    if (bytes < LARGE_BLOCK_BYTES) {
+        return ::operator new(bytes);
+    }
+#ifdef _WIN32
+    // Large pages need SeLockMemoryPrivilege, which normal users don't have
+    void* memory = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+#else
+    HugePages mode = hugePageMode;
+    void* memory = nullptr;
+    Mapping mapping = {nullptr, bytes};
+
+#if defined(MAP_HUGETLB)
+    if (mode == HugePages::Explicit) {
+        mapping.bytes = roundUp(bytes, HUGE_PAGE_BYTES);
+        memory = mapAnonymous(mapping.bytes, MAP_HUGETLB);
+        if (!memory && !explicitFallbackReported.exchange(true)) {
+            std::cerr << "No explicit huge pages available (see /proc/sys/vm/nr_hugepages), "
+                      << "using transparent huge pages" << std::endl;
+        }
+    }
+#endif
+#if defined(MADV_HUGEPAGE)
+    if (!memory && mode != HugePages::Off) {
+        memory = mapTransparent(bytes, mapping);
+    }
+#endif
+    if (!memory) {
+        mapping.bytes = bytes;
+        memory = mapAnonymous(bytes, 0);
+    }
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+
+    mapping.base = memory;
+    std::lock_guard<std::mutex> lock(mappingsMutex);
+    mappings[memory] = mapping;
+    return memory;
+#endif
+}
+
+void release(void* memory, size_t bytes) {
+    if (!memory) {
+        return;
+    }
+    if (bytes < LARGE_BLOCK_BYTES) {
+        ::operator delete(memory);
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    Mapping mapping = {memory, bytes};
+    {
+        std::lock_guard<std::mutex> lock(mappingsMutex);
+        auto found = mappings.find(memory);
+        if (found != mappings.end()) {
+            mapping = found->second;
+            mappings.erase(found);
+        }
+    }
+    munmap(mapping.base, mapping.bytes);
+#endif
+}
+
+} // namespace FrameMemory
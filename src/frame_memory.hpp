@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Memory for full-frame arrays such as export images and iteration grids. Large blocks
+// come straight from the OS, page-aligned and untouched, so each page lands on the
+// NUMA node of the thread that first writes it (or where CpuTopology::bindMemory put it)
+// instead of wherever the allocating thread happened to run.
+// Large blocks can also be backed by 2 MB huge pages, which cuts TLB misses when
+// tiles are copied into, or colours read from, frames of many megabytes.
+namespace FrameMemory {
+    // Smaller blocks come from the regular heap
+    const size_t LARGE_BLOCK_BYTES = 1 << 20;
+
+    enum class HugePages {
+        Off,
+        Transparent,  // 2 MB aligned and madvise(MADV_HUGEPAGE); the kernel may still say no
+        Explicit      // MAP_HUGETLB from the reserved pool, Transparent when it's empty
+    };
+
+    // Applies to blocks allocated afterwards; Linux only, elsewhere always Off
+    void setHugePages(HugePages mode);
+    HugePages getHugePages();
+
+    // "off", "transparent" or "explicit"; false if unrecognised
+    bool parseHugePages(const std::string& name, HugePages& mode);
+    const char* hugePagesName(HugePages mode);
+
+    // Throws std::bad_alloc
+    void* allocate(size_t bytes);
+    void release(void* memory, size_t bytes);
+}
+
+// std::vector allocator over FrameMemory. Default-constructed elements are left
+// uninitialized, so resize() doesn't write (and place) every page from one thread;
+// whoever fills the buffer decides where it lives.
+template <typename T>
+struct FrameAllocator {
+    using value_type = T;
+
+    FrameAllocator() = default;
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(FrameMemory::allocate(count * sizeof(T)));
+    }
+    void deallocate(T* memory, size_t count) {
+        FrameMemory::release(memory, count * sizeof(T));
+    }
+
+    template <typename U>
+    void construct(U* element) {
+        ::new (static_cast<void*>(element)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* element, Args&&... args) {
+        ::new (static_cast<void*>(element)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const FrameAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const FrameAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
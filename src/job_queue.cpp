@@ -0,0 +1,152 @@
+#include "job_queue.hpp"
+#include <algorithm>
+#include <sstream>
+
+static std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(start, end - start + 1);
+}
+
+bool parseRenderJob(const std::string& text, RenderJob& job, std::string& error) {
+    std::istringstream input(text);
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(input, line)) {
+        ++lineNumber;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            error = "line " + std::to_string(lineNumber) + ": expected key=value";
+            return false;
+        }
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+
+        try {
+            if (key == "name") job.name = value;
+            else if (key == "output") job.output = value;
+            else if (key == "raw_output") job.rawOutput = value;
+            else if (key == "center_x") job.centerX = std::stod(value);
+            else if (key == "center_y") job.centerY = std::stod(value);
+            else if (key == "zoom") job.zoom = std::stod(value);
+            else if (key == "max_iterations") job.maxIterations = std::stoi(value);
+            else if (key == "color_mode") job.colorMode = std::stoi(value);
+            else if (key == "color_shift") job.colorShift = std::stod(value);
+            else if (key == "width") job.width = std::stoi(value);
+            else if (key == "height") job.height = std::stoi(value);
+            else if (key == "frames") job.frames = std::stoi(value);
+            else if (key == "end_zoom") job.endZoom = std::stod(value);
+            else if (key == "motion_blur") job.motionBlurSamples = std::stoi(value);
+            else if (key == "shutter") job.shutter = std::stod(value);
+            else if (key == "priority") {
+                if (value == "interactive") job.priority = JobPriority::Interactive;
+                else if (value == "normal") job.priority = JobPriority::Normal;
+                else if (value == "background") job.priority = JobPriority::Background;
+                else {
+                    error = "line " + std::to_string(lineNumber) + ": unknown priority '" + value + "'";
+                    return false;
+                }
+            } else {
+                error = "line " + std::to_string(lineNumber) + ": unknown key '" + key + "'";
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            error = "line " + std::to_string(lineNumber) + ": invalid value for '" + key + "'";
+            return false;
+        }
+    }
+
+    if (job.output.empty()) {
+        error = "missing output";
+        return false;
+    }
+    if (job.width <= 0 || job.height <= 0 || job.maxIterations <= 0 || job.zoom <= 0.0) {
+        error = "width, height, max_iterations and zoom must be positive";
+        return false;
+    }
+    if (job.colorMode < 0 || job.colorMode > 5) {
+        error = "color_mode must be between 0 and 5";
+        return false;
+    }
+
+    if (job.endZoom == 0.0) {
+        job.endZoom = job.zoom;
+    }
+    if (job.frames < 1 || job.frames > 99999 || !(job.endZoom > 0.0)) {
+        error = "frames must be between 1 and 99999 and end_zoom positive";
+        return false;
+    }
+    if (job.motionBlurSamples < 1 || job.motionBlurSamples > 64 || !(job.shutter >= 0.0 && job.shutter <= 1.0)) {
+        error = "motion_blur must be between 1 and 64 and shutter between 0 and 1";
+        return false;
+    }
+    if (job.isZoomPath() && !job.rawOutput.empty()) {
+        error = "raw_output can't be combined with frames or motion_blur";
+        return false;
+    }
+    return true;
+}
+
+JobQueue::JobQueue()
+    : nextSequence(0)
+{
+}
+
+bool JobQueue::runsBefore(const RenderJob& a, uint64_t sequenceA, const RenderJob& b, uint64_t sequenceB) {
+    if (a.priority != b.priority) {
+        return a.priority < b.priority;
+    }
+    if (a.remainingCost != b.remainingCost) {
+        return a.remainingCost < b.remainingCost;
+    }
+    return sequenceA < sequenceB;
+}
+
+void JobQueue::push(std::shared_ptr<RenderJob> job) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back(Entry{std::move(job), nextSequence++});
+}
+
+std::shared_ptr<RenderJob> JobQueue::pop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.empty()) {
+        return nullptr;
+    }
+
+    auto best = std::min_element(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return runsBefore(*a.job, a.sequence, *b.job, b.sequence);
+    });
+    std::shared_ptr<RenderJob> job = best->job;
+    entries.erase(best);
+    return job;
+}
+
+bool JobQueue::shouldPreempt(const RenderJob& running) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Entry& entry : entries) {
+        // Only strictly better jobs preempt, so equal jobs don't thrash
+        if (entry.job->priority != running.priority) {
+            if (entry.job->priority < running.priority) {
+                return true;
+            }
+        } else if (entry.job->remainingCost < running.remainingCost) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t JobQueue::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "cost_estimator.hpp"
+#include "frame_memory.hpp"
+
+// Priority classes, most urgent first
+enum class JobPriority {
+    Interactive = 0,
+    Normal = 1,
+    Background = 2
+};
+
+struct RenderJob {
+    int id = 0;
+    std::string name;
+    JobPriority priority = JobPriority::Normal;
+
+    double centerX = -0.5;
+    double centerY = 0.0;
+    double zoom = 1.0;
+    int maxIterations = 200;
+    int colorMode = 1;
+    double colorShift = 1.8;
+    int width = 1920;
+    int height = 1080;
+    std::string output;
+    std::string rawOutput;  // Optional compressed iteration export
+    std::string jobFile;  // Spool file the job was submitted through
+
+    // Zoom path: frames frames zooming from zoom to endZoom, each the average of
+    // motionBlurSamples sub-frames spread over shutter frame intervals. Frames are
+    // written as numbered PNGs next to output.
+    int frames = 1;
+    double endZoom = 0.0;  // 0 for the start zoom
+    int motionBlurSamples = 1;
+    double shutter = 0.5;
+    bool failed = false;  // A frame couldn't be saved
+
+    bool isZoomPath() const { return frames > 1 || motionBlurSamples > 1; }
+
+    // Estimated cost of the whole job and of the tiles still to render, in iterations
+    double estimatedCost = 0.0;
+    double remainingCost = 0.0;
+
+    RenderBackend backend = RenderBackend::CpuTiles;
+
+    // Progress, kept across preemption. A band is bandRows rows of tiles, or one frame
+    // of a zoom path.
+    int nextBand = 0;
+    int bandCount = 0;
+    int bandRows = 1;
+    FrameVector<unsigned char> image;
+    FrameVector<int> iterations;  // Only kept for a raw export
+    int colorTasksPending = 0;    // Bands not yet coloured into image, guarded by the renderer
+};
+
+// Parses a key=value job description; returns false with a message on bad input
+bool parseRenderJob(const std::string& text, RenderJob& job, std::string& error);
+
+// Jobs ordered by priority class, then shortest remaining estimated cost, then arrival.
+// Running jobs are preempted at tile granularity when a better job is queued.
+class JobQueue {
+public:
+    JobQueue();
+
+    void push(std::shared_ptr<RenderJob> job);
+    std::shared_ptr<RenderJob> pop();
+
+    // True if a queued job should run before the given one
+    bool shouldPreempt(const RenderJob& running) const;
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+private:
+    struct Entry {
+        std::shared_ptr<RenderJob> job;
+        uint64_t sequence;
+    };
+
+    static bool runsBefore(const RenderJob& a, uint64_t sequenceA, const RenderJob& b, uint64_t sequenceB);
+
+    mutable std::mutex mutex;
+    std::vector<Entry> entries;
+    uint64_t nextSequence;
+};
@@ -0,0 +1,127 @@
+#include "lod_pyramid.hpp"
+#include <algorithm>
+#include <cmath>
+#include "trace.hpp"
+
+// Mips stop once either side would drop below this
+const int MIN_LEVEL_SIZE = 16;
+
+LodPyramid::LodPyramid(size_t maxFrames)
+    : maxFrames(std::max<size_t>(maxFrames, 2))
+{
+}
+
+void LodPyramid::addFrame(const unsigned char* rgb, int width, int height,
+                          double centerX, double centerY, double pixelSize) {
+    if (width <= 0 || height <= 0 || pixelSize <= 0.0) {
+        return;
+    }
+    TRACE_SCOPE("lod", "lod add frame");
+
+    Frame frame;
+    frame.centerX = centerX;
+    frame.centerY = centerY;
+    frame.pixelSize = pixelSize;
+    frame.levels.push_back(Level{width, height, std::vector<unsigned char>(rgb, rgb + static_cast<size_t>(width) * height * 3)});
+
+    while (frame.levels.back().width / 2 >= MIN_LEVEL_SIZE && frame.levels.back().height / 2 >= MIN_LEVEL_SIZE) {
+        const Level& fine = frame.levels.back();
+        Level coarse{fine.width / 2, fine.height / 2, {}};
+        coarse.rgb.resize(static_cast<size_t>(coarse.width) * coarse.height * 3);
+        for (int y = 0; y < coarse.height; ++y) {
+            const unsigned char* row0 = fine.rgb.data() + static_cast<size_t>(2 * y) * fine.width * 3;
+            const unsigned char* row1 = row0 + fine.width * 3;
+            unsigned char* out = coarse.rgb.data() + static_cast<size_t>(y) * coarse.width * 3;
+            for (int x = 0; x < coarse.width * 3; ++x) {
+                int c = x % 3;
+                int sx = (x - c) * 2 + c;
+                out[x] = static_cast<unsigned char>((row0[sx] + row0[sx + 3] + row1[sx] + row1[sx + 3] + 2) / 4);
+            }
+        }
+        frame.levels.push_back(std::move(coarse));
+    }
+
+    // A frame at about the same level that overlaps the new one is superseded by it
+    for (auto it = frames.begin(); it != frames.end(); ++it) {
+        double ratio = it->pixelSize / pixelSize;
+        bool sameLevel = ratio > 0.5 && ratio < 2.0;
+        bool overlaps = std::fabs(it->centerX - centerX) < frame.extent() / 2 &&
+                        std::fabs(it->centerY - centerY) < height * pixelSize / 2;
+        if (sameLevel && overlaps) {
+            frames.erase(it);
+            break;
+        }
+    }
+    frames.push_back(std::move(frame));
+
+    // Evict the oldest frame, but keep the widest one as the backdrop for any zoom-out
+    if (frames.size() > maxFrames) {
+        auto widest = std::max_element(frames.begin(), frames.end(), [](const Frame& a, const Frame& b) {
+            return a.extent() < b.extent();
+        });
+        frames.erase(widest == frames.begin() ? frames.begin() + 1 : frames.begin());
+    }
+}
+
+double LodPyramid::compose(unsigned char* rgb, int width, int height,
+                           double centerX, double centerY, double pixelSize) const {
+    TRACE_SCOPE("lod", "lod compose");
+    std::fill(rgb, rgb + static_cast<size_t>(width) * height * 3, 0);
+    if (frames.empty() || width <= 0 || height <= 0) {
+        return 0.0;
+    }
+
+    // Coarsest first so finer detail is painted over it
+    std::vector<const Frame*> order;
+    for (const Frame& frame : frames) {
+        order.push_back(&frame);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const Frame* a, const Frame* b) {
+        return a->pixelSize > b->pixelSize;
+    });
+
+    std::vector<unsigned char> covered(static_cast<size_t>(width) * height, 0);
+    size_t coveredCount = 0;
+    std::vector<int> sourceX(width);
+
+    for (const Frame* frame : order) {
+        // Finest mip that is no finer than the target, so sampling doesn't alias
+        size_t levelIndex = 0;
+        while (levelIndex + 1 < frame->levels.size() &&
+               frame->pixelSize * (2 << levelIndex) <= pixelSize) {
+            ++levelIndex;
+        }
+        const Level& level = frame->levels[levelIndex];
+        const double scale = 1 << levelIndex;
+        const Level& base = frame->levels[0];
+
+        for (int x = 0; x < width; ++x) {
+            double u = ((centerX - frame->centerX) + (x - width / 2) * pixelSize) / frame->pixelSize + base.width / 2;
+            double s = std::floor((u + 0.5) / scale);
+            sourceX[x] = s >= 0 && s < level.width ? static_cast<int>(s) : -1;
+        }
+
+        for (int y = 0; y < height; ++y) {
+            double v = ((centerY - frame->centerY) + (y - height / 2) * pixelSize) / frame->pixelSize + base.height / 2;
+            double t = std::floor((v + 0.5) / scale);
+            if (t < 0 || t >= level.height) {
+                continue;
+            }
+            const unsigned char* row = level.rgb.data() + static_cast<size_t>(t) * level.width * 3;
+            unsigned char* out = rgb + static_cast<size_t>(y) * width * 3;
+            for (int x = 0; x < width; ++x) {
+                if (sourceX[x] < 0) {
+                    continue;
+                }
+                const unsigned char* src = row + sourceX[x] * 3;
+                out[x * 3] = src[0];
+                out[x * 3 + 1] = src[1];
+                out[x * 3 + 2] = src[2];
+                size_t index = static_cast<size_t>(y) * width + x;
+                coveredCount += covered[index] ? 0 : 1;
+                covered[index] = 1;
+            }
+        }
+    }
+    return static_cast<double>(coveredCount) / (static_cast<size_t>(width) * height);
+}
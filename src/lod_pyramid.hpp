@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Recently completed frames, each kept with 2x2-averaged mip levels, used to show an
+// approximation of a new view before it is rendered. A zoom-out is composed from the
+// mip of each stored frame closest to the new pixel size, coarsest frames first, so the
+// area seen before appears at once and only the newly exposed border starts out black
+// (or from an even coarser frame). Roughly one frame is kept per octave of zoom.
+class LodPyramid {
+public:
+    explicit LodPyramid(size_t maxFrames = 8);
+
+    // Stores a width x height RGB24 frame whose pixel (x, y) shows the point
+    // (centerX + (x - width / 2) * pixelSize, centerY + (y - height / 2) * pixelSize)
+    void addFrame(const unsigned char* rgb, int width, int height,
+                  double centerX, double centerY, double pixelSize);
+
+    // Fills rgb for the given view from stored frames; returns the fraction of pixels covered
+    double compose(unsigned char* rgb, int width, int height,
+                   double centerX, double centerY, double pixelSize) const;
+
+    void clear() { frames.clear(); }
+    bool empty() const { return frames.empty(); }
+
+private:
+    struct Level {
+        int width;
+        int height;
+        std::vector<unsigned char> rgb;
+    };
+
+    struct Frame {
+        double centerX;
+        double centerY;
+        double pixelSize;  // Of level 0
+        std::vector<Level> levels;
+
+        double extent() const { return levels[0].width * pixelSize; }
+    };
+
+    size_t maxFrames;
+    std::vector<Frame> frames;  // Oldest first
+};
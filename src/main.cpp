@@ -8,8 +8,28 @@
 #include <algorithm>
 #include <iomanip>
 #include <sstream>
+#include <memory>
+#include <chrono>
 #include "mandelbrot.hpp"
 #include "view_state.hpp"
+#include "texture_uploader.hpp"
+#include "tile_cache.hpp"
+#include "render_scheduler.hpp"
+#include "viewport.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+#include "batch_renderer.hpp"
+#include "cost_estimator.hpp"
+#include "tile_store.hpp"
+#include "lod_pyramid.hpp"
+#include "session.hpp"
+#include "frame_memory.hpp"
+#include "quality_profile.hpp"
+#include "thumbnail_cache.hpp"
+#include "pixel_batch.hpp"
+#include "tile_renderer.hpp"
+#include <filesystem>
+#include <future>
 
 // Structure to hold zoom state for smooth transitions
 struct ZoomState {
@@ -20,6 +40,25 @@ struct ZoomState {
 };
 std::vector<ZoomState> zoomHistory;
 
+// Parameters of the frame currently held in the viewer's image buffer
+struct FrameParams {
+    double centerX;
+    double centerY;
+    double zoom;
+    int maxIterations;
+    int colorMode;
+    double colorShift;
+    int width;
+    int height;
+
+    bool operator==(const FrameParams& other) const {
+        return centerX == other.centerX && centerY == other.centerY && zoom == other.zoom &&
+               maxIterations == other.maxIterations && colorMode == other.colorMode &&
+               colorShift == other.colorShift && width == other.width && height == other.height;
+    }
+    bool operator!=(const FrameParams& other) const { return !(*this == other); }
+};
+
 #define FULLSCREEN 0
 #define DEFAULT_MAX_ITERATIONS 200
 
@@ -45,6 +84,7 @@ bool debugMode = false;
 bool highQualityMode = true;
 bool adaptiveRenderScale = false;
 bool smoothZoomMode = true;
+bool regionSelectMode = false;  // Selection re-renders a region instead of zooming
 bool isDragging = false;
 bool isPanning = false;
 bool drawing = false;
@@ -110,12 +150,110 @@ int maxIterations = DEFAULT_MAX_ITERATIONS;
 int highQualityMultiplier = 4;
 int minQualityMultiplier = 1;
 double renderScale = 1.0;
-double minRenderScale = 0.25;
 double smoothZoomFactor = 1.01;
 double fastSmoothZoomFactor = 1.04;
 
 double panSpeed = 0.01;
 
+// Region re-render settings, relative to the current frame
+const int REGION_ITERATION_MULTIPLIER = 4;
+const int REGION_SUPERSAMPLE = 2;
+
+// Escape radius of region re-renders (--region-bailout). Their colouring follows the
+// active quality profile, so a region matches the frame it is merged into.
+double regionBailoutRadius = 16.0;
+
+// Quality profiles (--profiles <file> adds or overrides them, --profile <name> picks the
+// starting one). P cycles through them; high-resolution renders always use "final".
+std::vector<QualityProfile> qualityProfiles = QualityProfiles::builtIn();
+size_t activeProfile = 1;
+FrameBudgetController frameBudget;
+
+// While the view changes, frames are drawn at renderScale by a second viewer and
+// stretched to the window; once it has been still for SETTLE_DELAY the full frame follows
+std::unique_ptr<MandelbrotViewer> scaledViewer;
+std::unique_ptr<TextureUploader> scaledUploader;
+bool scaledFrameShown = false;
+Uint32 lastViewChange = 0;
+const Uint32 SETTLE_DELAY = 150;
+
+// Auto iterations: the limit follows a low-resolution probe of each settled view
+bool autoIterations = false;
+const int AUTO_ITERATIONS_MAX = 8192;
+CostEstimator costEstimator;
+ZoomState autoIterationsView = {0.0, 0.0, 0.0, 0};
+
+// Earlier frames used to show a zoom-out before it is rendered
+LodPyramid lodPyramid;
+FrameVector<unsigned char> lodPreview;
+const double LOD_PREVIEW_MIN_ZOOM_OUT = 1.5;  // Smaller steps render fast enough as is
+
+// Multi-view workspace: side-by-side viewports served by one tile scheduler.
+// The global view parameters always describe the active viewport.
+bool splitView = false;
+const int SPLIT_VIEWPORT_COUNT = 2;
+const size_t TILE_CACHE_CAPACITY = 64 * 1024 * 1024;  // Compressed bytes
+std::unique_ptr<TileCache> tileCache;
+std::unique_ptr<TileStore> tileStore;  // Tiles persisted across sessions; may be null
+std::unique_ptr<RenderScheduler> renderScheduler;
+std::vector<std::unique_ptr<Viewport>> viewports;
+std::vector<ZoomState> viewportViews;
+int activeViewport = 0;
+
+// Timeline trace written when recording stops (F9 or exit)
+std::string traceFilename = "mandelbrot_trace.json";
+
+// Prometheus /metrics endpoint, disabled unless --metrics-port is given
+int metricsPort = 0;
+
+// On-disk tile pyramid reopened at startup (--tile-store, --tile-store-mb, --no-tile-store)
+std::string tileStoreFilename = "mandelbrot_tiles.store";
+size_t tileStoreMegabytes = 256;
+
+// Session recording and deterministic replay (--record, --replay, --replay-realtime)
+std::string recordFilename;
+std::string replayFilename;
+bool replayRealTime = false;
+
+// Thumbnails of saved views for the Load browser, rendered in the background and kept
+// in a cache directory (--thumbnail-cache). Created when the browser first opens.
+std::unique_ptr<ThumbnailCache> thumbnailCache;
+std::string thumbnailCacheDirectory = "mandelbrot_thumbnails";
+
+// Loaded views whose first frame the cost probe expects to take longer than this on the
+// OpenCL device are refused (--max-view-seconds, 0 to allow any)
+double maxViewSeconds = 20.0;
+const int VIEW_COST_PROBE_ITERATIONS = 4096;
+
+// Hybrid preview (G, --hybrid): a new view is first drawn from a quick low-resolution CPU
+// pass, then the device frame replaces it band by band as the bands arrive, instead of
+// the main loop waiting for the whole frame
+bool hybridPreview = false;
+bool hybridShown = false;  // hybridImage is on screen and the device frame is still arriving
+FrameVector<unsigned char> hybridImage;
+std::unique_ptr<PixelBatch> previewBatch;  // Shared by the startup and hybrid previews
+const int HYBRID_PREVIEW_DIVISOR = 4;
+const int HYBRID_PREVIEW_MAX_ITERATIONS = 1024;
+
+// Iteration budget (B, --iteration-budget <n>): a frame whose limit is above the budget is
+// iterated across displayed frames, n more iterations per unresolved pixel each time, so
+// the viewer stays responsive and the image sharpens until every pixel has resolved
+bool iterationBudgetMode = false;
+int iterationBudget = 4096;
+
+// Startup: the OpenCL device is initialised and the kernels compiled on a background
+// thread while the window opens; until then a CPU preview of the starting view is shown.
+// Milestones are measured from launch and reported once the first full frame is up.
+const std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+double firstPixelMs = 0.0;
+double deviceReadyMs = 0.0;
+bool startupReported = false;
+const int STARTUP_PREVIEW_DIVISORS[] = {8, 2};  // Coarse first, then finer while waiting
+
+// Headless batch rendering from a spool directory (--batch)
+std::string batchDirectory;
+bool batchExitWhenIdle = false;
+
 // Mouse state
 int lastMouseX = 0;
 int lastMouseY = 0;
@@ -132,7 +270,7 @@ bool keyPressed[4] = {false, false, false, false}; // up, down, left, right
 // Function declarations
 void drawUI(SDL_Renderer* renderer, TTF_Font* font, TTF_Font* titleFont, TTF_Font* messageFont, int width, int height);
 void drawMenu(SDL_Renderer* renderer, TTF_Font* font, int width);
-void drawSelectionRectangle(SDL_Renderer* renderer, int startX, int startY, int currentX, int currentY);
+void drawSelectionRectangle(SDL_Renderer* renderer, int startX, int startY, int currentX, int currentY, bool squareSelection = true);
 void zoomToSelection(int startX, int startY, int currentX, int currentY, double& centerX, double& centerY, double& zoom);
 void smoothZoomToCursor(bool zoomOut, int mouseX, int mouseY, double& centerX, double& centerY, double& zoom);
 void panView(bool& isPanning, double& centerX, double& centerY, double zoom);
@@ -142,15 +280,145 @@ void resetView(double& centerX, double& centerY, double& zoom, int& maxIteration
 void saveViewToHistory(double centerX, double& centerY, double& zoom, int maxIterations);
 void zoomOut(double& centerX, double& centerY, double& zoom, int& maxIterations, MandelbrotViewer& viewer);
 bool showFileDialog(SDL_Renderer* renderer, TTF_Font* font, const std::string& title, std::string& filename);
+bool showViewBrowser(SDL_Renderer* renderer, TTF_Font* font, std::string& filename);
 std::string findFontPath(const std::string& fontName);
 bool renderHighResImage(const std::string& filename, SDL_Renderer* renderer, 
                        double centerX, double centerY, double zoom, 
                        int maxIterations, int colorMode, double colorShift);
 void showAboutDialog(SDL_Renderer* renderer, TTF_Font* font);
+void layoutViewports(SDL_Renderer* renderer);
+void setActiveViewport(int index);
+void zoomViewportAt(const Viewport& viewport, int mouseX, int mouseY, double factor, double& centerX, double& centerY, double& zoom);
+void applyQualityProfile(const QualityProfile& profile, MandelbrotViewer& viewer);
+void renderScaledFrame(SDL_Renderer* renderer, MandelbrotViewer& viewer, int maxIter);
+std::unique_ptr<MandelbrotViewer> showStartupPreview(SDL_Renderer* renderer,
+                                                     std::future<std::unique_ptr<MandelbrotViewer>>& viewerReady,
+                                                     bool& quitRequested);
+double millisecondsSinceLaunch();
+void renderCpuPreview(int divisor, int maxIter, int iterationCap, std::vector<unsigned char>& rgb,
+                      int& width, int& height);
+void beginHybridFrame(MandelbrotViewer& viewer, int maxIter);
+bool updateHybridFrame(MandelbrotViewer& viewer, TextureUploader& uploader);
+bool viewWithinBudget(const ViewState& state);
 
 int main(int argc, char* argv[]) {
     try {
         std::cout << "Starting Mandelbrot Viewer..." << std::endl;
+
+        Trace::setThreadName("Main");
+        std::string profilesFilename;
+        std::string startProfile = "interactive";
+        double bailoutOverride = 0.0;
+        double exportBailoutOverride = 0.0;
+        bool bandedColors = false;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--trace" && i + 1 < argc) {
+                // Record from startup until F9 or exit
+                traceFilename = argv[++i];
+                Trace::start();
+            } else if (arg == "--metrics-port" && i + 1 < argc) {
+                metricsPort = std::atoi(argv[++i]);
+            } else if (arg == "--batch" && i + 1 < argc) {
+                batchDirectory = argv[++i];
+            } else if (arg == "--batch-exit-when-idle") {
+                batchExitWhenIdle = true;
+            } else if (arg == "--tile-store" && i + 1 < argc) {
+                tileStoreFilename = argv[++i];
+            } else if (arg == "--tile-store-mb" && i + 1 < argc) {
+                tileStoreMegabytes = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+            } else if (arg == "--no-tile-store") {
+                tileStoreFilename.clear();
+            } else if (arg == "--record" && i + 1 < argc) {
+                recordFilename = argv[++i];
+            } else if (arg == "--replay" && i + 1 < argc) {
+                replayFilename = argv[++i];
+            } else if (arg == "--replay-realtime") {
+                replayRealTime = true;
+            } else if (arg == "--bailout" && i + 1 < argc) {
+                bailoutOverride = std::atof(argv[++i]);
+            } else if (arg == "--region-bailout" && i + 1 < argc) {
+                regionBailoutRadius = std::atof(argv[++i]);
+            } else if (arg == "--export-bailout" && i + 1 < argc) {
+                exportBailoutOverride = std::atof(argv[++i]);
+            } else if (arg == "--banded") {
+                bandedColors = true;
+            } else if (arg == "--max-view-seconds" && i + 1 < argc) {
+                maxViewSeconds = std::max(0.0, std::atof(argv[++i]));
+            } else if (arg == "--thumbnail-cache" && i + 1 < argc) {
+                thumbnailCacheDirectory = argv[++i];
+            } else if (arg == "--iteration-budget" && i + 1 < argc) {
+                iterationBudgetMode = true;
+                iterationBudget = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--hybrid") {
+                hybridPreview = true;
+            } else if (arg == "--profiles" && i + 1 < argc) {
+                profilesFilename = argv[++i];
+            } else if (arg == "--profile" && i + 1 < argc) {
+                startProfile = argv[++i];
+            } else if (arg == "--huge-pages" && i + 1 < argc) {
+                FrameMemory::HugePages mode;
+                if (FrameMemory::parseHugePages(argv[++i], mode)) {
+                    FrameMemory::setHugePages(mode);
+                } else {
+                    std::cerr << "Unknown --huge-pages mode " << argv[i]
+                              << ", expected off, transparent or explicit" << std::endl;
+                }
+            }
+        }
+
+        if (!profilesFilename.empty()) {
+            std::string profileError;
+            if (!QualityProfiles::load(profilesFilename, qualityProfiles, profileError)) {
+                std::cerr << "Using the built-in quality profiles: " << profileError << std::endl;
+            }
+        }
+        for (size_t i = 0; i < qualityProfiles.size(); ++i) {
+            QualityProfile& profile = qualityProfiles[i];
+            if (profile.name == startProfile) {
+                activeProfile = i;
+            }
+            if (bailoutOverride > 0.0 && profile.name == "interactive") {
+                profile.bailout.radius = bailoutOverride;
+            }
+            if (exportBailoutOverride > 0.0 && profile.name == "final") {
+                profile.bailout.radius = exportBailoutOverride;
+            }
+            if (bandedColors) {
+                profile.bailout.smoothColoring = false;
+            }
+        }
+        if (qualityProfiles[activeProfile].name != startProfile) {
+            std::cerr << "Unknown quality profile " << startProfile << ", using "
+                      << qualityProfiles[activeProfile].name << std::endl;
+        }
+
+        if (!tileStoreFilename.empty()) {
+            // Rendering works without it, just without persistence
+            try {
+                tileStore.reset(new TileStore(tileStoreFilename, tileStoreMegabytes * 1024 * 1024));
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Tile store disabled: " << e.what() << std::endl;
+            }
+        }
+
+        Metrics::MetricsServer metricsServer;
+        if (metricsPort > 0) {
+            metricsServer.start(metricsPort);
+        }
+
+        if (!batchDirectory.empty()) {
+            // No window: render queued jobs on the tile scheduler and exit
+            TileCache batchCache(TILE_CACHE_CAPACITY);
+            RenderScheduler batchScheduler(batchCache, 0, tileStore.get());
+            BatchRenderer batchRenderer(batchDirectory, batchScheduler, batchCache);
+            batchRenderer.run(batchExitWhenIdle);
+            if (Trace::isEnabled()) {
+                Trace::stop(traceFilename);
+            }
+            return 0;
+        }
         
         std::cout << "Initializing SDL..." << std::endl;
         if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -192,6 +460,16 @@ int main(int argc, char* argv[]) {
         WINDOW_HEIGHT = 600;
 #endif
 
+        // Device setup and kernel compilation take the longest; start them now so they
+        // overlap window creation, font loading and the CPU preview
+        std::cout << "Creating Mandelbrot viewer in the background..." << std::endl;
+        std::future<std::unique_ptr<MandelbrotViewer>> viewerReady = std::async(std::launch::async,
+            [width = WINDOW_WIDTH, height = WINDOW_HEIGHT, iterations = maxIterations, mode = colorMode, shift = colorShift] {
+                Trace::setThreadName("OpenCL init");
+                TRACE_SCOPE("startup", "createViewer");
+                return std::unique_ptr<MandelbrotViewer>(new MandelbrotViewer(width, height, iterations, mode, shift));
+            });
+
 
 
         std::cout << "Creating window..." << std::endl;
@@ -220,16 +498,11 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
-        SDL_Texture* texture = SDL_CreateTexture(
-            renderer,
-            SDL_PIXELFORMAT_RGB24,
-            SDL_TEXTUREACCESS_STREAMING,
-            WINDOW_WIDTH,
-            WINDOW_HEIGHT
-        );
-
-        if (!texture) {
-            std::cerr << "Failed to create texture: " << SDL_GetError() << std::endl;
+        std::unique_ptr<TextureUploader> uploader;
+        try {
+            uploader.reset(new TextureUploader(renderer, WINDOW_WIDTH, WINDOW_HEIGHT));
+        }
+        catch (const std::exception& e) {
             SDL_DestroyRenderer(renderer);
             SDL_DestroyWindow(window);
             TTF_Quit();
@@ -241,7 +514,7 @@ int main(int argc, char* argv[]) {
         std::string fontPath = findFontPath("arial.ttf");
         if (fontPath.empty()) {
             std::cerr << "Failed to find arial.ttf in any of the search paths" << std::endl;
-            SDL_DestroyTexture(texture);
+            uploader.reset();
             SDL_DestroyRenderer(renderer);
             SDL_DestroyWindow(window);
             TTF_Quit();
@@ -255,7 +528,7 @@ int main(int argc, char* argv[]) {
         
         if (!font || !titleFont || !messageFont) {
             std::cerr << "Failed to load fonts: " << TTF_GetError() << std::endl;
-            SDL_DestroyTexture(texture);
+            uploader.reset();
             SDL_DestroyRenderer(renderer);
             SDL_DestroyWindow(window);
             TTF_Quit();
@@ -263,18 +536,38 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
-        std::cout << "Creating Mandelbrot viewer..." << std::endl;
-        MandelbrotViewer viewer(WINDOW_WIDTH, WINDOW_HEIGHT, maxIterations, colorMode, colorShift);
+        bool quitRequested = false;
+        std::unique_ptr<MandelbrotViewer> viewerOwner = showStartupPreview(renderer, viewerReady, quitRequested);
+        MandelbrotViewer& viewer = *viewerOwner;
+        applyQualityProfile(qualityProfiles[activeProfile], viewer);
 
         // Save initial view to history
         saveViewToHistory(centerX, centerY, zoom, maxIterations);
 
+        int exitCode = 0;
+        if (!replayFilename.empty()) {
+            if (!Session::startReplay(replayFilename, replayRealTime, WINDOW_WIDTH, WINDOW_HEIGHT)) {
+                // Skip the main loop but still clean up
+                quitRequested = true;
+                exitCode = 1;
+            }
+        } else if (!recordFilename.empty()) {
+            Session::startRecording(recordFilename, WINDOW_WIDTH, WINDOW_HEIGHT);
+        }
+
         std::cout << "Entering main loop..." << std::endl;
-        bool running = true;
+        bool running = !quitRequested;
+        bool frameValid = false;
+        bool previewShown = false;  // lodPreview is on screen and the frame is still due
+        std::vector<SDL_Rect> pendingRegions;  // Region re-renders waiting for the device frame
+        FrameParams lastFrameParams = {};
         SDL_Event event;
 
         while (running) {
-            while (SDL_PollEvent(&event)) {
+            TRACE_SCOPE("frame", "frame");
+            Session::beginFrame();
+            bool deviceFrameShown = false;  // A complete device frame goes on screen this loop
+            while (Session::pollEvent(&event)) {
                 switch (event.type) {
                     case SDL_QUIT:
                         running = false;
@@ -289,7 +582,7 @@ int main(int argc, char* argv[]) {
                                     viewMenuOpen = false;  // Close View menu if open
                                     helpMenuOpen = false;  // Close Help menu if open
                                     ignoreMouseActions = true;
-                                    menuActionTime = SDL_GetTicks();
+                                    menuActionTime = Session::ticks();
                                 }
                                 // Check if View menu was clicked
                                 else if (event.button.x >= 180 && event.button.x <= 230) {
@@ -297,7 +590,7 @@ int main(int argc, char* argv[]) {
                                     fileMenuOpen = false;  // Close File menu if open
                                     helpMenuOpen = false;  // Close Help menu if open
                                     ignoreMouseActions = true;
-                                    menuActionTime = SDL_GetTicks();
+                                    menuActionTime = Session::ticks();
                                 }
                                 // Check if Help menu was clicked
                                 else if (event.button.x >= 310 && event.button.x <= 360) {
@@ -306,7 +599,7 @@ int main(int argc, char* argv[]) {
                                     viewMenuOpen = false;
                                     renderMenuOpen = false;
                                     ignoreMouseActions = true;
-                                    menuActionTime = SDL_GetTicks();
+                                    menuActionTime = Session::ticks();
                                 }
                                 // Check if Render menu was clicked
                                 else if (event.button.x >= 240 && event.button.x <= 300) {
@@ -315,7 +608,7 @@ int main(int argc, char* argv[]) {
                                     viewMenuOpen = false;
                                     helpMenuOpen = false;
                                     ignoreMouseActions = true;
-                                    menuActionTime = SDL_GetTicks();
+                                    menuActionTime = Session::ticks();
                                 }
                             } else if (fileMenuOpen) {
                                 // Check if click is outside menu area
@@ -324,7 +617,7 @@ int main(int argc, char* argv[]) {
                                     event.button.x > 230 || 
                                     event.button.y > MENU_HEIGHT + MENU_ITEM_HEIGHT * 4) {
                                     fileMenuOpen = false;
-                                    dialogCloseTime = SDL_GetTicks();
+                                    dialogCloseTime = Session::ticks();
                                 } else if (event.button.y >= MENU_HEIGHT && event.button.y < MENU_HEIGHT + MENU_ITEM_HEIGHT * 4) {
                                     // Check if menu items were clicked
                                     if (event.button.x >= 130 && event.button.x <= 230) {
@@ -334,8 +627,8 @@ int main(int argc, char* argv[]) {
                                             pendingMenuItem = menuItem;
                                             fileMenuOpen = false;
                                             ignoreMouseActions = true;
-                                            menuActionTime = SDL_GetTicks();
-                                            popupDelayTime = SDL_GetTicks();  // Start popup delay timer
+                                            menuActionTime = Session::ticks();
+                                            popupDelayTime = Session::ticks();  // Start popup delay timer
                                         }
                                     }
                                 }
@@ -346,15 +639,15 @@ int main(int argc, char* argv[]) {
                                     event.button.x > 280 || 
                                     event.button.y > MENU_HEIGHT + MENU_ITEM_HEIGHT) {
                                     viewMenuOpen = false;
-                                    dialogCloseTime = SDL_GetTicks();
+                                    dialogCloseTime = Session::ticks();
                                 } else if (event.button.y >= MENU_HEIGHT && event.button.y < MENU_HEIGHT + MENU_ITEM_HEIGHT) {
                                     // Check if menu item was clicked
                                     if (event.button.x >= 180 && event.button.x <= 280) {
                                         isMaximized = !isMaximized;
                                         viewMenuOpen = false;
                                         ignoreMouseActions = true;
-                                        menuActionTime = SDL_GetTicks();
-                                        popupDelayTime = SDL_GetTicks();
+                                        menuActionTime = Session::ticks();
+                                        popupDelayTime = Session::ticks();
 
                                         // Store the resize action
                                         pendingMenuItem = 4;  // Use 4 for View menu actions
@@ -367,7 +660,7 @@ int main(int argc, char* argv[]) {
                                     event.button.x > 410 || 
                                     event.button.y > MENU_HEIGHT + MENU_ITEM_HEIGHT) {
                                     helpMenuOpen = false;
-                                    dialogCloseTime = SDL_GetTicks();
+                                    dialogCloseTime = Session::ticks();
                                 } else if (event.button.y >= MENU_HEIGHT && 
                                          event.button.y < MENU_HEIGHT + MENU_ITEM_HEIGHT) {
                                     // About menu item clicked
@@ -375,8 +668,8 @@ int main(int argc, char* argv[]) {
                                         pendingMenuItem = MENU_ITEM_ABOUT;
                                         helpMenuOpen = false;
                                         ignoreMouseActions = true;
-                                        menuActionTime = SDL_GetTicks();
-                                        popupDelayTime = SDL_GetTicks();
+                                        menuActionTime = Session::ticks();
+                                        popupDelayTime = Session::ticks();
                                     }
                                 }
                             } else if (renderMenuOpen) {
@@ -386,7 +679,7 @@ int main(int argc, char* argv[]) {
                                     event.button.x > 340 || 
                                     event.button.y > MENU_HEIGHT + MENU_ITEM_HEIGHT) {
                                     renderMenuOpen = false;
-                                    dialogCloseTime = SDL_GetTicks();
+                                    dialogCloseTime = Session::ticks();
                                 } else if (event.button.y >= MENU_HEIGHT && 
                                          event.button.y < MENU_HEIGHT + MENU_ITEM_HEIGHT) {
                                     // Image menu item clicked
@@ -394,13 +687,13 @@ int main(int argc, char* argv[]) {
                                         pendingMenuItem = MENU_ITEM_RENDER;
                                         renderMenuOpen = false;
                                         ignoreMouseActions = true;
-                                        menuActionTime = SDL_GetTicks();
-                                        popupDelayTime = SDL_GetTicks();
+                                        menuActionTime = Session::ticks();
+                                        popupDelayTime = Session::ticks();
                                     }
                                 }
-                            } else if (!ignoreMouseActions && (SDL_GetTicks() - menuActionTime > MENU_ACTION_DELAY) && 
-                                      (SDL_GetTicks() - dialogCloseTime > DIALOG_CLOSE_DELAY)) {  // Check dialog close timer
-                                if (smoothZoomMode) {
+                            } else if (!ignoreMouseActions && (Session::ticks() - menuActionTime > MENU_ACTION_DELAY) && 
+                                      (Session::ticks() - dialogCloseTime > DIALOG_CLOSE_DELAY)) {  // Check dialog close timer
+                                if ((smoothZoomMode && !regionSelectMode) || splitView) {
                                     // In smooth zoom mode, just update current position
                                     currentX = event.button.x;
                                     currentY = event.button.y;
@@ -415,8 +708,8 @@ int main(int argc, char* argv[]) {
                             }
                         } else if (event.button.button == SDL_BUTTON_RIGHT) {
                             if (!ignoreMouseActions && (!showMenu || event.button.y >= MENU_HEIGHT) && 
-                                (SDL_GetTicks() - menuActionTime > MENU_ACTION_DELAY) &&
-                                (SDL_GetTicks() - dialogCloseTime > DIALOG_CLOSE_DELAY)) {  // Check dialog close timer
+                                (Session::ticks() - menuActionTime > MENU_ACTION_DELAY) &&
+                                (Session::ticks() - dialogCloseTime > DIALOG_CLOSE_DELAY)) {  // Check dialog close timer
                                 if (!smoothZoomMode) {
                                     // Zoom out to previous view
                                     zoomOut(centerX, centerY, zoom, maxIterations, viewer);
@@ -424,8 +717,8 @@ int main(int argc, char* argv[]) {
                             }
                         } else if (event.button.button == SDL_BUTTON_MIDDLE) {
                             if (!ignoreMouseActions && (!showMenu || event.button.y >= MENU_HEIGHT) && 
-                                (SDL_GetTicks() - menuActionTime > MENU_ACTION_DELAY) &&
-                                (SDL_GetTicks() - dialogCloseTime > DIALOG_CLOSE_DELAY)) {  // Check dialog close timer
+                                (Session::ticks() - menuActionTime > MENU_ACTION_DELAY) &&
+                                (Session::ticks() - dialogCloseTime > DIALOG_CLOSE_DELAY)) {  // Check dialog close timer
                                 // Middle click for panning
                                 isDragging = true;
                                 lastMouseX = event.button.x;
@@ -437,19 +730,32 @@ int main(int argc, char* argv[]) {
                     case SDL_MOUSEBUTTONUP:
                         if (event.button.button == SDL_BUTTON_LEFT) {
                             if (!ignoreMouseActions && (!showMenu || event.button.y >= MENU_HEIGHT) && 
-                                (SDL_GetTicks() - menuActionTime > MENU_ACTION_DELAY)) {  // Check timer
+                                (Session::ticks() - menuActionTime > MENU_ACTION_DELAY)) {  // Check timer
                                 if (drawing) {
                                     // Complete selection rectangle
                                     drawing = false;
                                     if (abs(currentX - startX) > 5 && abs(currentY - startY) > 5) {
-                                        zoomToSelection(startX, startY, currentX, currentY, centerX, centerY, zoom);
+                                        if (regionSelectMode) {
+                                            // Re-render just the selected rectangle and merge it into the frame
+                                            SDL_Rect region = {
+                                                std::min(startX, currentX),
+                                                std::min(startY, currentY),
+                                                std::abs(currentX - startX),
+                                                std::abs(currentY - startY)
+                                            };
+                                            // Merged into the device frame by the main loop, once a hybrid
+                                            // or iteration-budget frame has finished
+                                            pendingRegions.push_back(region);
+                                        } else {
+                                            zoomToSelection(startX, startY, currentX, currentY, centerX, centerY, zoom);
+                                        }
                                     }
                                 }
                             }
                             ignoreMouseActions = false;  // Reset the flag on mouse button up
                         } else if (event.button.button == SDL_BUTTON_MIDDLE) {
                             if (!ignoreMouseActions && (!showMenu || event.button.y >= MENU_HEIGHT) && 
-                                (SDL_GetTicks() - menuActionTime > MENU_ACTION_DELAY)) {  // Check timer
+                                (Session::ticks() - menuActionTime > MENU_ACTION_DELAY)) {  // Check timer
                                 // Stop panning
                                 isDragging = false;
                             }
@@ -457,8 +763,17 @@ int main(int argc, char* argv[]) {
                         break;
 
                     case SDL_MOUSEMOTION:
+                        // In split view the viewport under an idle mouse becomes active
+                        if (splitView && !isDragging && Session::mouseState(nullptr, nullptr) == 0) {
+                            for (int i = 0; i < static_cast<int>(viewports.size()); ++i) {
+                                if (viewports[i]->contains(event.motion.x, event.motion.y)) {
+                                    setActiveViewport(i);
+                                    break;
+                                }
+                            }
+                        }
                         if (!ignoreMouseActions && (!showMenu || event.motion.y >= MENU_HEIGHT) && 
-                            (SDL_GetTicks() - menuActionTime > MENU_ACTION_DELAY)) {  // Check timer
+                            (Session::ticks() - menuActionTime > MENU_ACTION_DELAY)) {  // Check timer
                             if (isDragging) {
                                 // Panning with middle mouse button
                                 int currentX = event.motion.x;
@@ -467,9 +782,15 @@ int main(int argc, char* argv[]) {
                                 int deltaY = currentY - lastMouseY;
                                 
                                 // Convert pixel movement to complex plane movement
-                                double scale = 4.0 / zoom;
-                                centerX -= deltaX * scale / WINDOW_WIDTH;
-                                centerY -= deltaY * scale / WINDOW_HEIGHT;  // Inverted y-axis by changing + to -
+                                if (splitView) {
+                                    double pixelSize = 4.0 / zoom / viewports[activeViewport]->getRect().h;
+                                    centerX -= deltaX * pixelSize;
+                                    centerY -= deltaY * pixelSize;
+                                } else {
+                                    double scale = 4.0 / zoom;
+                                    centerX -= deltaX * scale / WINDOW_WIDTH;
+                                    centerY -= deltaY * scale / WINDOW_HEIGHT;  // Inverted y-axis by changing + to -
+                                }
                                 
                                 lastMouseX = currentX;
                                 lastMouseY = currentY;
@@ -484,7 +805,13 @@ int main(int argc, char* argv[]) {
                     case SDL_MOUSEWHEEL:
                         {
                             int mouseX, mouseY;
-                            SDL_GetMouseState(&mouseX, &mouseY);
+                            Session::mouseState(&mouseX, &mouseY);
+                            if (splitView) {
+                                zoomViewportAt(*viewports[activeViewport], mouseX, mouseY,
+                                               event.wheel.y > 0 ? 1.1 : 1.0 / 1.1, centerX, centerY, zoom);
+                                saveViewToHistory(centerX, centerY, zoom, maxIterations);
+                                break;
+                            }
                             double mouseXPlane = centerX + (mouseX - WINDOW_WIDTH/2.0) * (4.0/zoom) / WINDOW_WIDTH;
                             double mouseYPlane = centerY - (mouseY - WINDOW_HEIGHT/2.0) * (4.0/zoom) / WINDOW_HEIGHT;
                             
@@ -509,7 +836,7 @@ int main(int argc, char* argv[]) {
                         }
                         switch (event.key.keysym.sym) {
                             case SDLK_c:
-                                colorMode = (colorMode + 1) % 6;
+                                colorMode = (colorMode + 1) % VIEW_COLOR_MODES;
                                 viewer.setColorMode(colorMode);
                                 break;
                             case SDLK_z:
@@ -524,6 +851,49 @@ int main(int argc, char* argv[]) {
                                 smoothZoomMode = !smoothZoomMode;
                                 std::cout << "Zoom mode: " << (smoothZoomMode ? "Smooth" : "Rectangle") << std::endl;
                                 break;
+                            case SDLK_TAB:
+                                splitView = !splitView;
+                                if (splitView) {
+                                    layoutViewports(renderer);
+                                    // Every viewport starts from the current view
+                                    ZoomState current = {centerX, centerY, zoom, maxIterations};
+                                    viewportViews.assign(viewports.size(), current);
+                                    activeViewport = 0;
+                                }
+                                std::cout << "Split view: " << (splitView ? "On" : "Off") << std::endl;
+                                break;
+                            case SDLK_F9:
+                                if (Trace::isEnabled()) {
+                                    Trace::stop(traceFilename);
+                                } else {
+                                    Trace::start();
+                                }
+                                break;
+                            case SDLK_l:
+                                autoIterations = !autoIterations;
+                                autoIterationsView = {0.0, 0.0, 0.0, 0};
+                                std::cout << "Auto iterations: " << (autoIterations ? "On" : "Off") << std::endl;
+                                break;
+                            case SDLK_b:
+                                iterationBudgetMode = !iterationBudgetMode;
+                                frameValid = false;
+                                std::cout << "Iteration budget: " << (iterationBudgetMode ? std::to_string(iterationBudget) +
+                                             " per pixel per frame" : "Off") << std::endl;
+                                break;
+                            case SDLK_g:
+                                hybridPreview = !hybridPreview;
+                                frameValid = false;
+                                std::cout << "Hybrid CPU/GPU preview: " << (hybridPreview ? "On" : "Off") << std::endl;
+                                break;
+                            case SDLK_f:
+                                regionSelectMode = !regionSelectMode;
+                                std::cout << "Region re-render tool: " << (regionSelectMode ? "On" : "Off") << std::endl;
+                                break;
+                            case SDLK_p:
+                                activeProfile = (activeProfile + 1) % qualityProfiles.size();
+                                applyQualityProfile(qualityProfiles[activeProfile], viewer);
+                                frameValid = false;
+                                break;
                             case SDLK_q:
                                 adjustQualityMultiplier(false, highQualityMultiplier, minQualityMultiplier);
                                 break;
@@ -590,7 +960,7 @@ int main(int argc, char* argv[]) {
             }
 
             // Handle pending popup when delay has elapsed
-            if (pendingMenuItem != -1 && SDL_GetTicks() - popupDelayTime > POPUP_DELAY) {
+            if (pendingMenuItem != -1 && Session::ticks() - popupDelayTime > POPUP_DELAY) {
                 int menuItem = pendingMenuItem;
                 pendingMenuItem = -1;  // Reset pending menu item
                 
@@ -602,6 +972,10 @@ int main(int argc, char* argv[]) {
                         {
                             std::string filename = lastFilename;
                             if (showFileDialog(renderer, font, "Enter filename to save:", filename)) {
+                                // The view browser lists .view files
+                                if (std::filesystem::path(filename).extension().empty()) {
+                                    filename += ".view";
+                                }
                                 lastFilename = filename;
                                 ViewState state = {
                                     centerX, centerY, zoom, maxIterations,
@@ -618,10 +992,10 @@ int main(int argc, char* argv[]) {
                     case 2: // Load
                         {
                             std::string filename = lastFilename;
-                            if (showFileDialog(renderer, font, "Enter filename to load:", filename)) {
+                            if (showViewBrowser(renderer, font, filename)) {
                                 lastFilename = filename;
                                 ViewState state;
-                                if (loadViewState(filename.c_str(), state)) {
+                                if (loadViewState(filename, state) && viewWithinBudget(state)) {
                                     centerX = state.centerX;
                                     centerY = state.centerY;
                                     zoom = state.zoom;
@@ -671,17 +1045,11 @@ int main(int argc, char* argv[]) {
                             SDL_SetWindowPosition(window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
                             
                             // Recreate the texture with new size
-                            SDL_DestroyTexture(texture);
-                            texture = SDL_CreateTexture(
-                                renderer,
-                                SDL_PIXELFORMAT_RGB24,
-                                SDL_TEXTUREACCESS_STREAMING,
-                                WINDOW_WIDTH,
-                                WINDOW_HEIGHT
-                            );
-                            
-                            if (!texture) {
-                                std::cerr << "Failed to create texture: " << SDL_GetError() << std::endl;
+                            try {
+                                uploader->resize(WINDOW_WIDTH, WINDOW_HEIGHT);
+                            }
+                            catch (const std::exception& e) {
+                                uploader.reset();
                                 SDL_DestroyRenderer(renderer);
                                 SDL_DestroyWindow(window);
                                 TTF_Quit();
@@ -691,6 +1059,9 @@ int main(int argc, char* argv[]) {
                             
                             // Update viewer size
                             viewer.resize(WINDOW_WIDTH, WINDOW_HEIGHT);
+                            if (!viewports.empty()) {
+                                layoutViewports(renderer);
+                            }
                         }
                         break;
                     case MENU_ITEM_RENDER: // Render Image
@@ -712,61 +1083,186 @@ int main(int argc, char* argv[]) {
             }
 
             // Handle continuous zooming in the main loop
-            if (smoothZoomMode) {
-                Uint32 mouseState = SDL_GetMouseState(&currentX, &currentY);
+            bool zoomHeld = false;
+            if (smoothZoomMode && !regionSelectMode) {
+                Uint32 mouseState = Session::mouseState(&currentX, &currentY);
                 // Prevent zooming if menu is open or y is in menu bar
                 if (!showMenu || (currentY < 0 || currentY >= MENU_HEIGHT)) {
-                    if (SDL_GetTicks() - menuActionTime > MENU_ACTION_DELAY && 
-                        SDL_GetTicks() - dialogCloseTime > DIALOG_CLOSE_DELAY) {  // Check dialog close timer
+                    if (Session::ticks() - menuActionTime > MENU_ACTION_DELAY && 
+                        Session::ticks() - dialogCloseTime > DIALOG_CLOSE_DELAY) {  // Check dialog close timer
                         if (mouseState & SDL_BUTTON(SDL_BUTTON_LEFT)) {
                             // Zoom in while left button is held
                             smoothZoomToCursor(false, currentX, currentY, centerX, centerY, zoom);
+                            zoomHeld = true;
                         } else if (mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT)) {
                             // Zoom out while right button is held
                             smoothZoomToCursor(true, currentX, currentY, centerX, centerY, zoom);
+                            zoomHeld = true;
                         }
                     }
                 }
             }
 
             // Handle panning
-            if (isPanning && SDL_GetTicks() - menuActionTime > MENU_ACTION_DELAY) {  // Check timer
+            if (isPanning && Session::ticks() - menuActionTime > MENU_ACTION_DELAY) {  // Check timer
                 panView(isPanning, centerX, centerY, zoom);
             }
 
-            // Update render scale based on movement
-            if (adaptiveRenderScale) {
-                if (isPanning || smoothZoomMode || drawing) {
-                    renderScale = minRenderScale;
-                } else {
-                    renderScale = 1.0;
-                }
-            } else {
-                renderScale = 1.0;
+            // Scale of frames drawn while the view changes, chosen to fit the profile's frame budget
+            renderScale = adaptiveRenderScale ? frameBudget.getScale() : 1.0;
+
+            // Probing every frame of a pan or a held zoom would cost more than it saves;
+            // wheel steps and rectangle zooms are probed as they land
+            if (autoIterations && !isPanning && !zoomHeld &&
+                (centerX != autoIterationsView.centerX || centerY != autoIterationsView.centerY ||
+                 zoom != autoIterationsView.zoom)) {
+                maxIterations = costEstimator.suggestMaxIterations(centerX, centerY, zoom, WINDOW_WIDTH, WINDOW_HEIGHT,
+                                                                   DEFAULT_MAX_ITERATIONS, AUTO_ITERATIONS_MAX);
+                autoIterationsView = {centerX, centerY, zoom, maxIterations};
             }
 
-            // Compute frame with current parameters
+            // Compute frame only when the view actually changed since the last one
             int effectiveMaxIter = highQualityMode ? maxIterations * highQualityMultiplier : maxIterations;
-            viewer.setMaxIterations(effectiveMaxIter);
-            viewer.computeFrame(centerX, centerY, zoom);
+            FrameParams frameParams = {
+                centerX, centerY, zoom, effectiveMaxIter,
+                colorMode, colorShift, WINDOW_WIDTH, WINDOW_HEIGHT
+            };
+            // Read every loop, not only after a scaled frame, so the Session calls of a
+            // replay don't depend on which scale the frame budget picked
+            const Uint32 frameTicks = Session::ticks();
+            if (splitView) {
+                viewportViews[activeViewport] = {centerX, centerY, zoom, maxIterations};
+                for (size_t i = 0; i < viewports.size(); ++i) {
+                    const ZoomState& view = viewportViews[i];
+                    int viewMaxIter = highQualityMode ? view.maxIterations * highQualityMultiplier : view.maxIterations;
+                    viewports[i]->setView(view.centerX, view.centerY, view.zoom, viewMaxIter, colorMode, colorShift);
+                    viewports[i]->update();
+                }
+            } else if (!frameValid || frameParams != lastFrameParams ||
+                       (scaledFrameShown && frameTicks - lastViewChange >= SETTLE_DELAY)) {
+                // Settling after a scaled frame is not a change and gets the full frame
+                bool viewChanged = !frameValid || frameParams != lastFrameParams;
+                if (viewChanged) {
+                    lastViewChange = frameTicks;
+                    // Drawn on the old view
+                    pendingRegions.clear();
+                }
+                bool colorsChanged = colorMode != lastFrameParams.colorMode || colorShift != lastFrameParams.colorShift;
+                if (colorsChanged) {
+                    lodPyramid.clear();
+                }
+
+                if (viewChanged && frameValid && adaptiveRenderScale && renderScale < 1.0) {
+                    renderScaledFrame(renderer, viewer, effectiveMaxIter);
+                    lastFrameParams = frameParams;
+                    scaledFrameShown = true;
+                    previewShown = false;
+                    hybridShown = false;
+                }
+                // Present a large zoom-out from earlier frames first and render it on the next pass
+                else if (frameValid && !previewShown && !colorsChanged && !lodPyramid.empty() &&
+                         qualityProfiles[activeProfile].lodPreview &&
+                         zoom * LOD_PREVIEW_MIN_ZOOM_OUT <= lastFrameParams.zoom) {
+                    lodPreview.resize(static_cast<size_t>(WINDOW_WIDTH) * WINDOW_HEIGHT * 3);
+                    lodPyramid.compose(lodPreview.data(), WINDOW_WIDTH, WINDOW_HEIGHT,
+                                       centerX, centerY, 4.0 / zoom / WINDOW_HEIGHT);
+                    previewShown = true;
+                    scaledFrameShown = false;
+                    hybridShown = false;
+                    uploader->markAllDirty();
+                } else if (iterationBudgetMode && effectiveMaxIter > iterationBudget) {
+                    viewer.setMaxIterations(effectiveMaxIter);
+                    viewer.beginProgressiveFrame(centerX, centerY, zoom);
+                    lastFrameParams = frameParams;
+                    frameValid = true;
+                    previewShown = false;
+                    scaledFrameShown = false;
+                    hybridShown = false;
+                    uploader->markAllDirty();
+                } else if (hybridPreview) {
+                    beginHybridFrame(viewer, effectiveMaxIter);
+                    lastFrameParams = frameParams;
+                    frameValid = true;
+                    previewShown = false;
+                    scaledFrameShown = false;
+                    uploader->markAllDirty();
+                } else {
+                    // Timed through the session so a replay picks the same scales
+                    Uint32 renderStart = Session::ticks();
+                    viewer.setMaxIterations(effectiveMaxIter);
+                    viewer.computeFrame(centerX, centerY, zoom);
+                    deviceFrameShown = true;
+                    if (viewChanged && adaptiveRenderScale) {
+                        // A full-resolution frame during movement tells the budget whether it still fits
+                        frameBudget.recordFrame(static_cast<double>(Session::ticks() - renderStart));
+                    }
+                    lodPyramid.addFrame(viewer.getImageData().data(), WINDOW_WIDTH, WINDOW_HEIGHT,
+                                        centerX, centerY, 4.0 / zoom / WINDOW_HEIGHT);
+                    lastFrameParams = frameParams;
+                    frameValid = true;
+                    previewShown = false;
+                    scaledFrameShown = false;
+                    hybridShown = false;
+                    uploader->markAllDirty();
+                }
+            }
+            if (viewer.bandedFrameActive() && updateHybridFrame(viewer, *uploader)) {
+                deviceFrameShown = true;
+            }
+            // Left alone while a scaled or zoom-out frame stands in for it; the next settled
+            // view starts over anyway
+            if (viewer.progressiveFrameActive() && !scaledFrameShown && !previewShown && !splitView) {
+                std::vector<std::pair<int, int>> resolvedRows;
+                if (viewer.continueProgressiveFrame(iterationBudget, resolvedRows)) {
+                    lodPyramid.addFrame(viewer.getImageData().data(), WINDOW_WIDTH, WINDOW_HEIGHT,
+                                        centerX, centerY, 4.0 / zoom / WINDOW_HEIGHT);
+                    deviceFrameShown = true;
+                }
+                for (const std::pair<int, int>& rows : resolvedRows) {
+                    SDL_Rect band = {0, rows.first, WINDOW_WIDTH, rows.second - rows.first};
+                    uploader->markDirty(band);
+                }
+            }
+            // A region only merges into the finished device frame of the view it was drawn on,
+            // so it waits for a banded or progressive frame without holding up the loop
+            if (!pendingRegions.empty() && !viewer.bandedFrameActive() && !viewer.progressiveFrameActive() &&
+                !scaledFrameShown && !previewShown) {
+                const BailoutSettings regionBailout = {regionBailoutRadius,
+                                                       qualityProfiles[activeProfile].bailout.smoothColoring};
+                for (const SDL_Rect& region : pendingRegions) {
+                    viewer.computeRegion(region.x, region.y, region.w, region.h,
+                                         effectiveMaxIter * REGION_ITERATION_MULTIPLIER,
+                                         REGION_SUPERSAMPLE, regionBailout);
+                    uploader->markDirty(region);
+                }
+                pendingRegions.clear();
+            }
 
             // Update texture
-            const std::vector<unsigned char>& imageData = viewer.getImageData();
+            const FrameVector<unsigned char>& imageData = previewShown ? lodPreview :
+                                                          hybridShown ? hybridImage : viewer.getImageData();
             if (imageData.empty()) {
                 std::cerr << "Error: Image data is empty!" << std::endl;
                 continue;
             }
 
-            SDL_UpdateTexture(texture, nullptr, imageData.data(), WINDOW_WIDTH * 3);
+            uploader->upload(imageData.data(), WINDOW_WIDTH * 3);
 
             // Draw frame
             SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
             SDL_RenderClear(renderer);
-            SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+            if (splitView) {
+                for (size_t i = 0; i < viewports.size(); ++i) {
+                    viewports[i]->draw(renderer, static_cast<int>(i) == activeViewport);
+                }
+            } else {
+                SDL_Texture* frameTexture = scaledFrameShown ? scaledUploader->getTexture() : uploader->getTexture();
+                SDL_RenderCopy(renderer, frameTexture, nullptr, nullptr);
+            }
             
             // Draw selection rectangle if active
             if (drawing) {
-                drawSelectionRectangle(renderer, startX, startY, currentX, currentY);
+                drawSelectionRectangle(renderer, startX, startY, currentX, currentY, !regionSelectMode);
             }
             
             // Draw UI if enabled
@@ -782,7 +1278,14 @@ int main(int argc, char* argv[]) {
             SDL_Color textColor = {255, 255, 255, 255};
 
             // Draw settings info in top right
-            std::string qualityText = highQualityMode ? "HQ " + std::to_string(highQualityMultiplier) + "x" : "Standard";
+            std::string qualityText = qualityProfiles[activeProfile].name + ", " +
+                (highQualityMode ? "HQ " + std::to_string(highQualityMultiplier) + "x" : "Standard");
+            if (autoIterations) {
+                qualityText += ", auto";
+            }
+            if (viewer.progressiveFrameActive()) {
+                qualityText += ", refining " + std::to_string(viewer.getProgressiveIterations());
+            }
             
             // Format numbers consistently with fixed precision
             std::stringstream ss;
@@ -848,20 +1351,49 @@ int main(int argc, char* argv[]) {
             }
             
             SDL_RenderPresent(renderer);
+            if (firstPixelMs == 0.0) {
+                // The device was ready before any startup preview, so this frame came first
+                firstPixelMs = millisecondsSinceLaunch();
+                Metrics::startupFirstPixel.set(static_cast<int64_t>(firstPixelMs));
+            }
+            // Previews, scaled and partial frames don't count as the first full frame
+            if (!startupReported && deviceFrameShown) {
+                startupReported = true;
+                double firstFrameMs = millisecondsSinceLaunch();
+                Metrics::startupFirstFrame.set(static_cast<int64_t>(firstFrameMs));
+                // Formatted locally so std::cout keeps its own precision for later reports
+                std::stringstream report;
+                report << std::fixed << std::setprecision(1)
+                       << "Startup: first pixel " << firstPixelMs << " ms, OpenCL ready " << deviceReadyMs
+                       << " ms, first full frame " << firstFrameMs << " ms";
+                std::cout << report.str() << std::endl;
+            }
+            Session::endFrame(centerX, centerY, zoom, maxIterations);
         }
 
         // Clean up
+        Session::stop();
+        if (Trace::isEnabled()) {
+            Trace::stop(traceFilename);
+        }
         TTF_CloseFont(font);
         TTF_CloseFont(titleFont);
         TTF_CloseFont(messageFont);
-        SDL_DestroyTexture(texture);
+        viewports.clear();
+        renderScheduler.reset();
+        tileCache.reset();
+        tileStore.reset();
+        scaledViewer.reset();
+        scaledUploader.reset();
+        thumbnailCache.reset();
+        uploader.reset();
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
         TTF_Quit();
         SDL_Quit();
         IMG_Quit();  // Cleanup SDL_image
 
-        return 0;
+        return exitCode;
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
@@ -890,6 +1422,7 @@ void drawUI(SDL_Renderer* renderer, TTF_Font* font, TTF_Font* titleFont, TTF_Fon
         "Controls:",
         " ",  
         "M: Toggle zoom mode (smooth/selection)",
+        "F: Toggle region re-render tool",
         "In Smooth Zoom Mode:",
         "  Left/Right click (hold): Smooth zoom", 
         "  Hold Shift for faster zooming",
@@ -900,6 +1433,7 @@ void drawUI(SDL_Renderer* renderer, TTF_Font* font, TTF_Font* titleFont, TTF_Fon
         "C: Change color mode",
         "Z/X: Shift colors",
         "Q/E: Change quality multiplier",
+        "P: Cycle quality profile",
         "R: Reset view"
     };
     
@@ -1069,7 +1603,7 @@ void drawMenu(SDL_Renderer* renderer, TTF_Font* font, int width) {
     }
 }
 
-void drawSelectionRectangle(SDL_Renderer* renderer, int startX, int startY, int currentX, int currentY) {
+void drawSelectionRectangle(SDL_Renderer* renderer, int startX, int startY, int currentX, int currentY, bool squareSelection) {
     // Draw the original rectangle (dimmed)
     SDL_SetRenderDrawColor(renderer, 100, 100, 100, 255);
     SDL_Rect originalRect = {
@@ -1080,6 +1614,11 @@ void drawSelectionRectangle(SDL_Renderer* renderer, int startX, int startY, int
     };
     SDL_RenderDrawRect(renderer, &originalRect);
     
+    // Region selections use the rectangle as drawn
+    if (!squareSelection) {
+        return;
+    }
+    
     // Calculate the square that will be zoomed into
     int centerX = (startX + currentX) / 2;
     int centerY = (startY + currentY) / 2;
@@ -1131,7 +1670,7 @@ void zoomToSelection(int startX, int startY, int currentX, int currentY, double&
 
 void smoothZoomToCursor(bool zoomOut, int mouseX, int mouseY, double& centerX, double& centerY, double& zoom) {
     // Get current time
-    Uint32 currentTime = SDL_GetTicks();
+    Uint32 currentTime = Session::ticks();
     
     // Check if enough time has passed since last zoom
     if (currentTime - lastZoomTime < ZOOM_INTERVAL) {
@@ -1143,11 +1682,18 @@ void smoothZoomToCursor(bool zoomOut, int mouseX, int mouseY, double& centerX, d
     double mouseYPlane = centerY + (mouseY - WINDOW_HEIGHT/2.0) * (4.0/zoom) / WINDOW_HEIGHT;  // Inverted y-axis
     
     // Check if Shift key is being held
-    bool shiftPressed = (SDL_GetModState() & KMOD_SHIFT) != 0;
+    bool shiftPressed = (Session::modState() & KMOD_SHIFT) != 0;
     
     // Choose the appropriate zoom factor based on Shift key state
     double currentZoomFactor = shiftPressed ? fastSmoothZoomFactor : smoothZoomFactor;
     
+    if (splitView) {
+        zoomViewportAt(*viewports[activeViewport], mouseX, mouseY,
+                       zoomOut ? 1.0 / currentZoomFactor : currentZoomFactor, centerX, centerY, zoom);
+        lastZoomTime = currentTime;
+        return;
+    }
+    
     // Apply zoom
     if (zoomOut) {
         zoom /= currentZoomFactor;
@@ -1266,7 +1812,7 @@ bool showFileDialog(SDL_Renderer* renderer, TTF_Font* font, const std::string& t
     
     while (!done) {
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        while (Session::pollEvent(&event)) {
             switch (event.type) {
                 case SDL_QUIT:
                     done = true;
@@ -1278,7 +1824,7 @@ bool showFileDialog(SDL_Renderer* renderer, TTF_Font* font, const std::string& t
                         event.button.x > DIALOG_X + DIALOG_WIDTH ||
                         event.button.y < DIALOG_Y || 
                         event.button.y > DIALOG_Y + DIALOG_HEIGHT) {
-                        dialogCloseTime = SDL_GetTicks();
+                        dialogCloseTime = Session::ticks();
                         done = true;
                     }
                     // Check OK button click
@@ -1288,7 +1834,7 @@ bool showFileDialog(SDL_Renderer* renderer, TTF_Font* font, const std::string& t
                              event.button.y <= BUTTON_Y + BUTTON_HEIGHT) {
                         filename = inputText;
                         result = true;
-                        dialogCloseTime = SDL_GetTicks();
+                        dialogCloseTime = Session::ticks();
                         done = true;
                     }
                     // Check Cancel button click
@@ -1296,7 +1842,7 @@ bool showFileDialog(SDL_Renderer* renderer, TTF_Font* font, const std::string& t
                              event.button.x <= CANCEL_BUTTON_X + BUTTON_WIDTH &&
                              event.button.y >= BUTTON_Y && 
                              event.button.y <= BUTTON_Y + BUTTON_HEIGHT) {
-                        dialogCloseTime = SDL_GetTicks();
+                        dialogCloseTime = Session::ticks();
                         done = true;
                     }
                     break;
@@ -1305,10 +1851,10 @@ bool showFileDialog(SDL_Renderer* renderer, TTF_Font* font, const std::string& t
                     if (event.key.keysym.sym == SDLK_RETURN) {
                         filename = inputText;
                         result = true;
-                        dialogCloseTime = SDL_GetTicks();
+                        dialogCloseTime = Session::ticks();
                         done = true;
                     } else if (event.key.keysym.sym == SDLK_ESCAPE) {
-                        dialogCloseTime = SDL_GetTicks();
+                        dialogCloseTime = Session::ticks();
                         done = true;
                     } else if (event.key.keysym.sym == SDLK_BACKSPACE && !inputText.empty()) {
                         inputText.pop_back();
@@ -1414,6 +1960,252 @@ bool showFileDialog(SDL_Renderer* renderer, TTF_Font* font, const std::string& t
     return result;
 }
 
+// Grid of thumbnails of the .view files next to the last used file. Thumbnails appear as
+// the background pool finishes them; Tab switches to typing a name instead.
+bool showViewBrowser(SDL_Renderer* renderer, TTF_Font* font, std::string& filename) {
+    namespace fs = std::filesystem;
+    const int THUMB_WIDTH = ThumbnailCache::THUMBNAIL_WIDTH;
+    const int THUMB_HEIGHT = ThumbnailCache::THUMBNAIL_HEIGHT;
+    const int CELL_WIDTH = THUMB_WIDTH + 20;
+    const int CELL_HEIGHT = THUMB_HEIGHT + 30;
+    const int HEADER_HEIGHT = 40;
+    const size_t MAX_LABEL_LENGTH = 20;
+
+    fs::path directory = fs::path(filename).parent_path();
+    if (directory.empty()) {
+        directory = ".";
+    }
+    std::vector<std::string> files;
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() == ".view" && it->is_regular_file(error)) {
+            files.push_back(it->path().string());
+        }
+    }
+    if (files.empty()) {
+        return showFileDialog(renderer, font, "Enter filename to load:", filename);
+    }
+    std::sort(files.begin(), files.end());
+
+    if (!thumbnailCache) {
+        thumbnailCache.reset(new ThumbnailCache(thumbnailCacheDirectory));
+    }
+
+    const int DIALOG_X = 40;
+    const int DIALOG_Y = 40;
+    const int DIALOG_WIDTH = std::max(CELL_WIDTH + 20, WINDOW_WIDTH - 80);
+    const int DIALOG_HEIGHT = std::max(HEADER_HEIGHT + CELL_HEIGHT + 10, WINDOW_HEIGHT - 80);
+    const int columns = std::max(1, (DIALOG_WIDTH - 20) / CELL_WIDTH);
+    const int visibleRows = std::max(1, (DIALOG_HEIGHT - HEADER_HEIGHT - 10) / CELL_HEIGHT);
+    const int rows = (static_cast<int>(files.size()) + columns - 1) / columns;
+    const int gridX = DIALOG_X + (DIALOG_WIDTH - columns * CELL_WIDTH) / 2;
+    const int gridY = DIALOG_Y + HEADER_HEIGHT;
+
+    std::vector<SDL_Texture*> thumbnails(files.size(), nullptr);
+    std::vector<SDL_Texture*> labels(files.size(), nullptr);
+    std::vector<unsigned char> rgb;
+    uint64_t seenGeneration = ~0ULL;
+    int scrollRow = 0;
+    int requestedRow = -1;
+    int selected = 0;
+    bool done = false;
+    bool result = false;
+    bool typeName = false;
+
+    // Everything is queued once, then the rows on screen again whenever they change so
+    // they are rendered first
+    for (auto it = files.rbegin(); it != files.rend(); ++it) {
+        thumbnailCache->request(*it);
+    }
+
+    auto indexAt = [&](int x, int y) {
+        if (x < gridX || y < gridY || x >= gridX + columns * CELL_WIDTH) {
+            return -1;
+        }
+        int row = (y - gridY) / CELL_HEIGHT;
+        int index = (scrollRow + row) * columns + (x - gridX) / CELL_WIDTH;
+        return row < visibleRows && index < static_cast<int>(files.size()) ? index : -1;
+    };
+    auto scrollTo = [&](int row) {
+        scrollRow = std::max(0, std::min(row, rows - visibleRows));
+    };
+
+    while (!done) {
+        SDL_Event event;
+        while (Session::pollEvent(&event)) {
+            switch (event.type) {
+                case SDL_QUIT:
+                    done = true;
+                    break;
+
+                case SDL_MOUSEWHEEL:
+                    scrollTo(scrollRow - event.wheel.y);
+                    break;
+
+                case SDL_MOUSEMOTION:
+                    {
+                        int index = indexAt(event.motion.x, event.motion.y);
+                        if (index >= 0) {
+                            selected = index;
+                        }
+                    }
+                    break;
+
+                case SDL_MOUSEBUTTONDOWN:
+                    if (event.button.x < DIALOG_X || event.button.x > DIALOG_X + DIALOG_WIDTH ||
+                        event.button.y < DIALOG_Y || event.button.y > DIALOG_Y + DIALOG_HEIGHT) {
+                        done = true;
+                    } else {
+                        int index = indexAt(event.button.x, event.button.y);
+                        if (index >= 0) {
+                            filename = files[index];
+                            result = true;
+                            done = true;
+                        }
+                    }
+                    break;
+
+                case SDL_KEYDOWN:
+                    switch (event.key.keysym.sym) {
+                        case SDLK_RETURN:
+                            filename = files[selected];
+                            result = true;
+                            done = true;
+                            break;
+                        case SDLK_ESCAPE:
+                            done = true;
+                            break;
+                        case SDLK_TAB:
+                            typeName = true;
+                            done = true;
+                            break;
+                        case SDLK_LEFT:  selected = std::max(0, selected - 1); break;
+                        case SDLK_RIGHT: selected = std::min(static_cast<int>(files.size()) - 1, selected + 1); break;
+                        case SDLK_UP:    selected = std::max(selected % columns, selected - columns); break;
+                        case SDLK_DOWN:
+                            if (selected + columns < static_cast<int>(files.size())) {
+                                selected += columns;
+                            }
+                            break;
+                        case SDLK_PAGEUP:   scrollTo(scrollRow - visibleRows); break;
+                        case SDLK_PAGEDOWN: scrollTo(scrollRow + visibleRows); break;
+                        default: break;
+                    }
+                    if (event.key.keysym.sym != SDLK_PAGEUP && event.key.keysym.sym != SDLK_PAGEDOWN) {
+                        // Keep the keyboard selection on screen
+                        int selectedRow = selected / columns;
+                        if (selectedRow < scrollRow) {
+                            scrollTo(selectedRow);
+                        } else if (selectedRow >= scrollRow + visibleRows) {
+                            scrollTo(selectedRow - visibleRows + 1);
+                        }
+                    }
+                    break;
+            }
+        }
+        if (done) {
+            break;
+        }
+
+        const int firstIndex = scrollRow * columns;
+        const int lastIndex = std::min(static_cast<int>(files.size()), (scrollRow + visibleRows) * columns);
+        if (requestedRow != scrollRow) {
+            for (int i = lastIndex - 1; i >= firstIndex; --i) {
+                thumbnailCache->request(files[i]);
+            }
+            requestedRow = scrollRow;
+            seenGeneration = ~0ULL;
+        }
+        uint64_t generation = thumbnailCache->getGeneration();
+        if (generation != seenGeneration) {
+            seenGeneration = generation;
+            for (int i = firstIndex; i < lastIndex; ++i) {
+                if (!thumbnails[i] && thumbnailCache->get(files[i], rgb)) {
+                    thumbnails[i] = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STATIC,
+                                                      THUMB_WIDTH, THUMB_HEIGHT);
+                    if (thumbnails[i]) {
+                        SDL_UpdateTexture(thumbnails[i], nullptr, rgb.data(), THUMB_WIDTH * 3);
+                    }
+                }
+            }
+        }
+
+        // Draw dialog background and border
+        SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+        SDL_Rect dialogRect = {DIALOG_X, DIALOG_Y, DIALOG_WIDTH, DIALOG_HEIGHT};
+        SDL_RenderFillRect(renderer, &dialogRect);
+        SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+        SDL_RenderDrawRect(renderer, &dialogRect);
+
+        // Draw title
+        SDL_Color textColor = {255, 255, 255, 255};
+        std::string title = "Load view from " + directory.string() +
+                            "  (Enter or click to load, Tab to type a name, Esc to cancel)";
+        SDL_Surface* titleSurface = TTF_RenderText_Solid(font, title.c_str(), textColor);
+        if (titleSurface) {
+            SDL_Texture* titleTexture = SDL_CreateTextureFromSurface(renderer, titleSurface);
+            SDL_Rect titleRect = {DIALOG_X + 10, DIALOG_Y + 10, titleSurface->w, titleSurface->h};
+            SDL_RenderCopy(renderer, titleTexture, nullptr, &titleRect);
+            SDL_FreeSurface(titleSurface);
+            SDL_DestroyTexture(titleTexture);
+        }
+
+        // Draw the visible thumbnails, grey until they are ready
+        for (int i = firstIndex; i < lastIndex; ++i) {
+            int cellX = gridX + (i % columns) * CELL_WIDTH;
+            int cellY = gridY + (i / columns - scrollRow) * CELL_HEIGHT;
+            SDL_Rect thumbRect = {cellX + 10, cellY, THUMB_WIDTH, THUMB_HEIGHT};
+            if (thumbnails[i]) {
+                SDL_RenderCopy(renderer, thumbnails[i], nullptr, &thumbRect);
+            } else {
+                SDL_SetRenderDrawColor(renderer, 80, 80, 80, 255);
+                SDL_RenderFillRect(renderer, &thumbRect);
+            }
+            if (i == selected) {
+                SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+                SDL_Rect highlight = {thumbRect.x - 2, thumbRect.y - 2, thumbRect.w + 4, thumbRect.h + 4};
+                SDL_RenderDrawRect(renderer, &highlight);
+            }
+
+            if (!labels[i]) {
+                std::string label = fs::path(files[i]).stem().string();
+                if (label.size() > MAX_LABEL_LENGTH) {
+                    label = label.substr(0, MAX_LABEL_LENGTH - 3) + "...";
+                }
+                SDL_Surface* labelSurface = TTF_RenderText_Solid(font, label.c_str(), textColor);
+                if (labelSurface) {
+                    labels[i] = SDL_CreateTextureFromSurface(renderer, labelSurface);
+                    SDL_FreeSurface(labelSurface);
+                }
+            }
+            if (labels[i]) {
+                int labelWidth = 0;
+                int labelHeight = 0;
+                SDL_QueryTexture(labels[i], nullptr, nullptr, &labelWidth, &labelHeight);
+                SDL_Rect labelRect = {cellX + (CELL_WIDTH - labelWidth) / 2, cellY + THUMB_HEIGHT + 4,
+                                      labelWidth, labelHeight};
+                SDL_RenderCopy(renderer, labels[i], nullptr, &labelRect);
+            }
+        }
+
+        SDL_RenderPresent(renderer);
+        SDL_Delay(16);
+    }
+
+    // Thumbnails that were never shown wait until the browser opens again
+    thumbnailCache->cancelPending();
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (thumbnails[i]) SDL_DestroyTexture(thumbnails[i]);
+        if (labels[i]) SDL_DestroyTexture(labels[i]);
+    }
+    dialogCloseTime = Session::ticks();
+
+    if (typeName) {
+        return showFileDialog(renderer, font, "Enter filename to load:", filename);
+    }
+    return result;
+}
+
 std::string findFontPath(const std::string& fontName) {
     // Try different possible locations
     std::vector<std::string> possiblePaths = {
@@ -1444,20 +2236,28 @@ std::string findFontPath(const std::string& fontName) {
 bool renderHighResImage(const std::string& filename, SDL_Renderer* renderer,
                        double centerX, double centerY, double zoom,
                        int maxIterations, int colorMode, double colorShift) {
-    // Create a temporary high-resolution viewer with the exact same parameters
-    int effectiveMaxIter = highQualityMode ? maxIterations * highQualityMultiplier : maxIterations;
+    // Exports always use the final profile, whichever one the window is on
+    const QualityProfile* finalProfile = QualityProfiles::find(qualityProfiles, "final");
+    const QualityProfile& profile = finalProfile ? *finalProfile : qualityProfiles[activeProfile];
+    // Never fewer iterations than the window's high quality mode is showing
+    int effectiveMaxIter = maxIterations *
+        std::max(profile.iterationMultiplier, highQualityMode ? highQualityMultiplier : 1);
     MandelbrotViewer highResViewer(RENDER_WIDTH, RENDER_HEIGHT, effectiveMaxIter, colorMode, colorShift);
-    
-    // Use the same quality settings as the main viewer
-    if (highQualityMode) {
-        highResViewer.setMaxIterations(effectiveMaxIter);
-    }
+    highResViewer.setBailout(profile.bailout);
+    highResViewer.setCompactedPasses(profile.compactedPasses);
     
     // Compute the high-resolution frame
-    highResViewer.computeFrame(centerX, centerY, zoom);
+    if (profile.supersample > 1) {
+        // One region covering the frame, with supersample x supersample samples per pixel
+        highResViewer.setView(centerX, centerY, zoom);
+        highResViewer.computeRegion(0, 0, RENDER_WIDTH, RENDER_HEIGHT, effectiveMaxIter,
+                                    profile.supersample, profile.bailout);
+    } else {
+        highResViewer.computeFrame(centerX, centerY, zoom);
+    }
     
     // Get the image data
-    const std::vector<unsigned char>& imageData = highResViewer.getImageData();
+    const FrameVector<unsigned char>& imageData = highResViewer.getImageData();
     if (imageData.empty()) {
         std::cerr << "Error: Failed to generate high-resolution image data" << std::endl;
         return false;
@@ -1490,10 +2290,10 @@ bool renderHighResImage(const std::string& filename, SDL_Renderer* renderer,
     std::cout << "  Iterations: " << effectiveMaxIter << std::endl;
     std::cout << "  Color mode: " << colorMode << std::endl;
     std::cout << "  Color shift: " << colorShift << std::endl;
-    std::cout << "  Quality mode: " << (highQualityMode ? "High" : "Standard") << std::endl;
-    if (highQualityMode) {
-        std::cout << "  Quality multiplier: " << highQualityMultiplier << "x" << std::endl;
-    }
+    std::cout << "  Bailout radius: " << profile.bailout.radius
+              << (profile.bailout.smoothColoring ? " (smooth)" : " (banded)") << std::endl;
+    std::cout << "  Quality profile: " << profile.name << " (" << profile.iterationMultiplier
+              << "x iterations, " << profile.supersample << "x" << profile.supersample << " samples)" << std::endl;
     return true;
 }
 
@@ -1513,7 +2313,7 @@ void showAboutDialog(SDL_Renderer* renderer, TTF_Font* font) {
     
     while (!done) {
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        while (Session::pollEvent(&event)) {
             switch (event.type) {
                 case SDL_QUIT:
                     done = true;
@@ -1525,7 +2325,7 @@ void showAboutDialog(SDL_Renderer* renderer, TTF_Font* font) {
                         event.button.x <= BUTTON_X + BUTTON_WIDTH &&
                         event.button.y >= BUTTON_Y && 
                         event.button.y <= BUTTON_Y + BUTTON_HEIGHT) {
-                        dialogCloseTime = SDL_GetTicks();
+                        dialogCloseTime = Session::ticks();
                         done = true;
                     }
                     // Check if click is outside dialog
@@ -1533,14 +2333,14 @@ void showAboutDialog(SDL_Renderer* renderer, TTF_Font* font) {
                         event.button.x > DIALOG_X + DIALOG_WIDTH ||
                         event.button.y < DIALOG_Y || 
                         event.button.y > DIALOG_Y + DIALOG_HEIGHT) {
-                        dialogCloseTime = SDL_GetTicks();
+                        dialogCloseTime = Session::ticks();
                         done = true;
                     }
                     break;
                     
                 case SDL_KEYDOWN:
                     if (event.key.keysym.sym == SDLK_ESCAPE) {
-                        dialogCloseTime = SDL_GetTicks();
+                        dialogCloseTime = Session::ticks();
                         done = true;
                     }
                     break;
@@ -1582,7 +2382,7 @@ void showAboutDialog(SDL_Renderer* renderer, TTF_Font* font) {
             "  - R: Reset view",
             "  - M: Toggle zoom mode (smooth/selection)",
             "  - H: Toggle help panels",
-            "  - P: Print current settings"
+            "  - P: Cycle quality profile (draft/interactive/final)"
         };
         
         int yOffset = DIALOG_Y + 50;
@@ -1620,4 +2420,264 @@ void showAboutDialog(SDL_Renderer* renderer, TTF_Font* font) {
         
         SDL_RenderPresent(renderer);
     }
-}
\ No newline at end of file
+}
+
+void layoutViewports(SDL_Renderer* renderer) {
+    if (!renderScheduler) {
+        tileCache.reset(new TileCache(TILE_CACHE_CAPACITY));
+        renderScheduler.reset(new RenderScheduler(*tileCache, 0, tileStore.get()));
+    }
+
+    // Side by side, each taking an equal share of the window width
+    int viewportWidth = WINDOW_WIDTH / SPLIT_VIEWPORT_COUNT;
+    for (int i = 0; i < SPLIT_VIEWPORT_COUNT; ++i) {
+        SDL_Rect rect = {i * viewportWidth, 0, viewportWidth, WINDOW_HEIGHT};
+        if (i < static_cast<int>(viewports.size())) {
+            viewports[i]->setRect(rect);
+        } else {
+            viewports.emplace_back(new Viewport(renderer, *renderScheduler, *tileCache, rect));
+        }
+    }
+}
+
+void setActiveViewport(int index) {
+    if (index == activeViewport) {
+        return;
+    }
+
+    // Park the global view in the old viewport and pick up the new one
+    viewportViews[activeViewport] = {centerX, centerY, zoom, maxIterations};
+    activeViewport = index;
+    const ZoomState& view = viewportViews[activeViewport];
+    centerX = view.centerX;
+    centerY = view.centerY;
+    zoom = view.zoom;
+    maxIterations = view.maxIterations;
+}
+
+void zoomViewportAt(const Viewport& viewport, int mouseX, int mouseY, double factor, double& centerX, double& centerY, double& zoom) {
+    const SDL_Rect& rect = viewport.getRect();
+    double localX = mouseX - rect.x - rect.w / 2.0;
+    double localY = mouseY - rect.y - rect.h / 2.0;
+
+    // Keep the point under the cursor fixed
+    double pixelSize = 4.0 / zoom / rect.h;
+    double pointX = centerX + localX * pixelSize;
+    double pointY = centerY + localY * pixelSize;
+
+    zoom *= factor;
+    double newPixelSize = 4.0 / zoom / rect.h;
+    centerX = pointX - localX * newPixelSize;
+    centerY = pointY - localY * newPixelSize;
+}
+
+void applyQualityProfile(const QualityProfile& profile, MandelbrotViewer& viewer) {
+    highQualityMode = profile.iterationMultiplier > 1;
+    highQualityMultiplier = std::max(profile.iterationMultiplier, minQualityMultiplier);
+    autoIterations = profile.autoIterations;
+    autoIterationsView = {0.0, 0.0, 0.0, 0};
+    adaptiveRenderScale = profile.frameBudgetMs > 0.0 || profile.renderScale < 1.0;
+    frameBudget.configure(profile);
+    viewer.setBailout(profile.bailout);
+    viewer.setCompactedPasses(profile.compactedPasses);
+    std::cout << "Quality profile: " << profile.name << std::endl;
+}
+
+void renderScaledFrame(SDL_Renderer* renderer, MandelbrotViewer& viewer, int maxIter) {
+    const QualityProfile& profile = qualityProfiles[activeProfile];
+    int width = std::max(1, static_cast<int>(WINDOW_WIDTH * renderScale));
+    int height = std::max(1, static_cast<int>(WINDOW_HEIGHT * renderScale));
+
+    // A frame of its own, so the full-resolution frame stays intact for region re-renders
+    // and the zoom-out pyramid. It shares the viewer's context and program: building
+    // those again here would stall the first pan for the kernel compile.
+    if (!scaledViewer) {
+        scaledViewer.reset(new MandelbrotViewer(viewer, width, height));
+    } else if (scaledViewer->getWidth() != width || scaledViewer->getHeight() != height) {
+        scaledViewer->resize(width, height);
+    }
+    if (!scaledUploader) {
+        scaledUploader.reset(new TextureUploader(renderer, width, height));
+    } else if (scaledUploader->getWidth() != width || scaledUploader->getHeight() != height) {
+        scaledUploader->resize(width, height);
+    }
+
+    scaledViewer->setMaxIterations(maxIter);
+    scaledViewer->setColorMode(colorMode);
+    scaledViewer->setColorShift(colorShift);
+    scaledViewer->setBailout(profile.bailout);
+    scaledViewer->setCompactedPasses(profile.compactedPasses);
+
+    // Timed through the session so a replay picks the same scales
+    Uint32 start = Session::ticks();
+    scaledViewer->computeFrame(centerX, centerY, zoom);
+    frameBudget.recordFrame(static_cast<double>(Session::ticks() - start));
+
+    scaledUploader->markAllDirty();
+    scaledUploader->upload(scaledViewer->getImageData().data(), width * 3);
+}
+
+// Probes a loaded view before it replaces the current one, so a file asking for a huge
+// iteration limit over the interior can't stall the viewer
+bool viewWithinBudget(const ViewState& state) {
+    if (maxViewSeconds <= 0.0) {
+        return true;
+    }
+    int iterations = state.highQualityMode ? state.maxIterations * state.highQualityMultiplier : state.maxIterations;
+    CostEstimate estimate = costEstimator.estimateCapped(state.centerX, state.centerY, state.zoom, iterations,
+                                                         WINDOW_WIDTH, WINDOW_HEIGHT, VIEW_COST_PROBE_ITERATIONS);
+    if (estimate.openclSeconds > maxViewSeconds) {
+        std::cerr << "Rejected view: estimated " << estimate.openclSeconds << " s per frame exceeds the "
+                  << maxViewSeconds << " s limit (--max-view-seconds)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+double millisecondsSinceLaunch() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchTime).count();
+}
+
+// Shows CPU renders of the starting view, coarse then finer, until the viewer being
+// created on the background thread is ready, and returns it. Closing the window in the
+// meantime sets quitRequested; the viewer is still waited for so it is torn down cleanly.
+std::unique_ptr<MandelbrotViewer> showStartupPreview(SDL_Renderer* renderer,
+                                                     std::future<std::unique_ptr<MandelbrotViewer>>& viewerReady,
+                                                     bool& quitRequested) {
+    TRACE_SCOPE("startup", "startupPreview");
+    const int effectiveIterations = highQualityMode ? maxIterations * highQualityMultiplier : maxIterations;
+    // Recording and replay start after this, so other input is simply dropped
+    auto drainEvents = [&quitRequested] {
+        SDL_Event event;
+        while (Session::pollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                quitRequested = true;
+            }
+        }
+    };
+
+    for (int divisor : STARTUP_PREVIEW_DIVISORS) {
+        if (quitRequested || viewerReady.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            break;
+        }
+
+        std::vector<unsigned char> rgb;
+        int width = 0;
+        int height = 0;
+        renderCpuPreview(divisor, effectiveIterations, effectiveIterations, rgb, width, height);
+
+        SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB24, SDL_TEXTUREACCESS_STATIC, width, height);
+        if (texture) {
+            SDL_UpdateTexture(texture, nullptr, rgb.data(), width * 3);
+            SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+            SDL_RenderPresent(renderer);
+            SDL_DestroyTexture(texture);
+            if (firstPixelMs == 0.0) {
+                firstPixelMs = millisecondsSinceLaunch();
+                Metrics::startupFirstPixel.set(static_cast<int64_t>(firstPixelMs));
+            }
+        }
+
+        drainEvents();
+    }
+
+    // Keep the window responsive while compilation finishes
+    while (viewerReady.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready) {
+        drainEvents();
+    }
+    std::unique_ptr<MandelbrotViewer> viewer = viewerReady.get();
+    deviceReadyMs = millisecondsSinceLaunch();
+    Metrics::startupDeviceReady.set(static_cast<int64_t>(deviceReadyMs));
+    return viewer;
+}
+
+// Low-resolution CPU render of the current view, one sample per divisor x divisor window
+// pixels, into a width x height RGB24 image. Pixels still running at iterationCap are
+// drawn as interior, which keeps deep views quick at the cost of some detail.
+void renderCpuPreview(int divisor, int maxIter, int iterationCap, std::vector<unsigned char>& rgb,
+                      int& width, int& height) {
+    TRACE_SCOPE("preview", "renderCpuPreview");
+    if (!previewBatch) {
+        previewBatch.reset(new PixelBatch());
+    }
+    width = std::max(1, WINDOW_WIDTH / divisor);
+    height = std::max(1, WINDOW_HEIGHT / divisor);
+    const int cap = std::min(maxIter, iterationCap);
+    const double pixelSize = 4.0 / zoom / height;  // Same mapping as the viewer
+    const int pixels = width * height;
+    std::vector<int> iterations(pixels);
+    previewBatch->clear();
+    for (int i = 0; i < pixels; ++i) {
+        int x = i % width;
+        int y = i / width;
+        previewBatch->add(centerX + (x + 0.5 - width / 2.0) * pixelSize,
+                          centerY + (y + 0.5 - height / 2.0) * pixelSize, i);
+        if (previewBatch->activeCount() == PixelBatch::CAPACITY) {
+            previewBatch->run(cap, iterations.data());
+            previewBatch->clear();
+        }
+    }
+    previewBatch->run(cap, iterations.data());
+    for (int& iter : iterations) {
+        if (iter >= cap) {
+            iter = maxIter;
+        }
+    }
+    rgb.resize(static_cast<size_t>(pixels) * 3);
+    TileRenderer::colorize(iterations.data(), pixels, maxIter, colorMode, colorShift, rgb.data());
+}
+
+// Fills hybridImage with a CPU preview of the current view, enlarged to the window, and
+// starts the device frame that will replace it
+void beginHybridFrame(MandelbrotViewer& viewer, int maxIter) {
+    std::vector<unsigned char> preview;
+    int previewWidth = 0;
+    int previewHeight = 0;
+    renderCpuPreview(HYBRID_PREVIEW_DIVISOR, maxIter, HYBRID_PREVIEW_MAX_ITERATIONS, preview,
+                     previewWidth, previewHeight);
+
+    hybridImage.resize(static_cast<size_t>(WINDOW_WIDTH) * WINDOW_HEIGHT * 3);
+    for (int y = 0; y < WINDOW_HEIGHT; ++y) {
+        const unsigned char* src = preview.data() +
+            static_cast<size_t>(std::min(previewHeight - 1, y / HYBRID_PREVIEW_DIVISOR)) * previewWidth * 3;
+        unsigned char* dst = hybridImage.data() + static_cast<size_t>(y) * WINDOW_WIDTH * 3;
+        for (int x = 0; x < WINDOW_WIDTH; ++x) {
+            const unsigned char* pixel = src + std::min(previewWidth - 1, x / HYBRID_PREVIEW_DIVISOR) * 3;
+            dst[x * 3] = pixel[0];
+            dst[x * 3 + 1] = pixel[1];
+            dst[x * 3 + 2] = pixel[2];
+        }
+    }
+
+    viewer.setMaxIterations(maxIter);
+    viewer.beginBandedFrame(centerX, centerY, zoom);
+    hybridShown = true;
+}
+
+// Copies the device bands that have arrived over the preview. A frame that is no longer
+// on screen (the view moved on to a scaled or zoom-out frame) is just drained. True when
+// the last band of the frame on screen arrived.
+bool updateHybridFrame(MandelbrotViewer& viewer, TextureUploader& uploader) {
+    std::vector<std::pair<int, int>> finishedRows;
+    bool complete = viewer.pollBandedFrame(finishedRows);
+    if (!hybridShown) {
+        return false;
+    }
+
+    const unsigned char* deviceImage = viewer.getImageData().data();
+    for (const std::pair<int, int>& rows : finishedRows) {
+        size_t begin = static_cast<size_t>(rows.first) * WINDOW_WIDTH * 3;
+        size_t end = static_cast<size_t>(rows.second) * WINDOW_WIDTH * 3;
+        std::copy(deviceImage + begin, deviceImage + end, hybridImage.data() + begin);
+        SDL_Rect band = {0, rows.first, WINDOW_WIDTH, rows.second - rows.first};
+        uploader.markDirty(band);
+    }
+
+    if (complete) {
+        // The device image is whole now and identical to what is on screen
+        lodPyramid.addFrame(deviceImage, WINDOW_WIDTH, WINDOW_HEIGHT, viewer.getCenterX(), viewer.getCenterY(),
+                            4.0 / viewer.getZoom() / WINDOW_HEIGHT);
+        hybridShown = false;
+    }
+    return complete;
+}
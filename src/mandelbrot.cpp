@@ -3,6 +3,33 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include "trace.hpp"
+#include "metrics.hpp"
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+namespace {
+
+// From this limit on computeFrame iterates in compacted passes; below it most pixels
+// escape early and the single kernel is cheaper than the per-pass round trips
+const int BATCH_MIN_ITERATIONS = 2048;
+
+// Iterations per pass, doubling from the first to the last: early passes retire the
+// bulk of the frame, later ones carry the few slow pixels with fewer relaunches
+const int FIRST_BATCH_STEPS = 256;
+const int MAX_BATCH_STEPS = 4096;
+
+// Must match BATCH_GROUP_SIZE in the kernel source
+const size_t BATCH_GROUP_SIZE = 64;
+
+// Banded frames: one band per row of 64x64 display tiles, with two on the device so it
+// never idles between them while a superseded frame still ends quickly
+const int BAND_ROWS = 64;
+const size_t MAX_BANDS_LAUNCHED = 2;
+
+} // namespace
 
 const std::string MandelbrotViewer::kernelSource = R"(
     #pragma OPENCL EXTENSION cl_khr_byte_addressable_store : enable
@@ -56,6 +83,57 @@ const std::string MandelbrotViewer::kernelSource = R"(
         return log(val * 0.5 + 0.5) / log(1.5);
     }
 
+    // Leaves |z|^2 at exit in *mag2 for escape_value
+    int escape_iterations(double x0, double y0, int max_iter, double bailout_sq, double *mag2) {
+        double x1 = 0.0;
+        double y1 = 0.0;
+        double x2 = 0.0;
+        double y2 = 0.0;
+        
+        int iter = 0;
+        
+        while (x2 + y2 <= bailout_sq && iter < max_iter) {
+            y1 = 2.0 * x1 * y1 + y0;
+            x1 = x2 - y2 + x0;
+            x2 = x1 * x1;
+            y2 = y1 * y1;
+            iter++;
+        }
+        *mag2 = x2 + y2;
+        return iter;
+    }
+
+    // Continuous escape count n + 1 - log2(log|z_n| / log R). Measuring log|z_n| in
+    // units of log R keeps it continuous across bands whatever the escape radius R, so
+    // a smaller radius only costs accuracy, not seams. Without smoothing it's the count.
+    double escape_value(int iter, double mag2, double bailout_sq, int smooth) {
+        if (!smooth || mag2 <= bailout_sq) {
+            return (double)iter;
+        }
+        return max(0.0, iter + 1.0 - log2(log(mag2) / log(bailout_sq)));
+    }
+
+    // Colour normalisation uses color_max_iter so regions escaping at a higher
+    // limit still match the palette of the surrounding frame
+    double3 shade(double value, int iter, int max_iter, int color_max_iter, int color_mode, double color_shift) {
+        if (iter >= max_iter) {
+            return (double3)(0.0, 0.0, 0.0);
+        }
+        
+        double norm_iter = value / color_max_iter;
+        norm_iter = apply_log_smooth(norm_iter);
+        
+        switch (color_mode) {
+            case 0: return rainbow_palette(norm_iter, color_shift);
+            case 1: return fire_palette(norm_iter, color_shift);
+            case 2: return electric_blue(norm_iter, color_shift);
+            case 3: return twilight_palette(norm_iter, color_shift);
+            case 4: return neon_palette(norm_iter, color_shift);
+            case 5: return vintage_sepia(norm_iter, color_shift);
+            default: return (double3)(0.0, 0.0, 0.0);
+        }
+    }
+
     __kernel void mandelbrot(__global int *iterations_out,
                             __global uchar *rgb_out,
                             __global double *x_array,
@@ -64,7 +142,9 @@ const std::string MandelbrotViewer::kernelSource = R"(
                             const int height,
                             const int max_iter,
                             const int color_mode,
-                            const double color_shift)
+                            const double color_shift,
+                            const double bailout_sq,
+                            const int smooth)
     {
         int gid = get_global_id(0);
         int x = gid % width;
@@ -72,56 +152,168 @@ const std::string MandelbrotViewer::kernelSource = R"(
         
         if (x >= width || y >= height) return;
         
-        double x0 = x_array[x];
-        double y0 = y_array[y];
+        double mag2;
+        int iter = escape_iterations(x_array[x], y_array[y], max_iter, bailout_sq, &mag2);
+        iterations_out[gid] = iter;
         
-        double x1 = 0.0;
-        double y1 = 0.0;
-        double x2 = 0.0;
-        double y2 = 0.0;
+        double value = escape_value(iter, mag2, bailout_sq, smooth);
+        double3 color = shade(value, iter, max_iter, max_iter, color_mode, color_shift);
+        int idx = gid * 3;
+        rgb_out[idx] = (uchar)(color.x * 255.0);
+        rgb_out[idx + 1] = (uchar)(color.y * 255.0);
+        rgb_out[idx + 2] = (uchar)(color.z * 255.0);
+    }
+
+    // Re-renders a sub-rectangle of the frame with its own iteration limit and
+    // supersample x supersample samples per pixel, writing into the full-frame buffers
+    __kernel void mandelbrot_region(__global int *iterations_out,
+                                   __global uchar *rgb_out,
+                                   __global double *x_array,
+                                   __global double *y_array,
+                                   const int width,
+                                   const int region_x,
+                                   const int region_y,
+                                   const int region_w,
+                                   const int region_h,
+                                   const int max_iter,
+                                   const int color_max_iter,
+                                   const int color_mode,
+                                   const double color_shift,
+                                   const int supersample,
+                                   const double step_x,
+                                   const double step_y,
+                                   const double bailout_sq,
+                                   const int smooth)
+    {
+        int gid = get_global_id(0);
+        if (gid >= region_w * region_h) return;
         
-        int iter = 0;
+        int x = region_x + gid % region_w;
+        int y = region_y + gid / region_w;
         
-        while (x2 + y2 <= 4.0 && iter < max_iter) {
-            y1 = 2.0 * x1 * y1 + y0;
-            x1 = x2 - y2 + x0;
-            x2 = x1 * x1;
-            y2 = y1 * y1;
-            iter++;
+        double3 sum = (double3)(0.0, 0.0, 0.0);
+        int max_sample_iter = 0;
+        for (int sy = 0; sy < supersample; sy++) {
+            for (int sx = 0; sx < supersample; sx++) {
+                double x0 = x_array[x] + ((sx + 0.5) / supersample - 0.5) * step_x;
+                double y0 = y_array[y] + ((sy + 0.5) / supersample - 0.5) * step_y;
+                double mag2;
+                int iter = escape_iterations(x0, y0, max_iter, bailout_sq, &mag2);
+                max_sample_iter = max(max_sample_iter, iter);
+                double value = escape_value(iter, mag2, bailout_sq, smooth);
+                sum += shade(value, iter, max_iter, color_max_iter, color_mode, color_shift);
+            }
         }
         
-        iterations_out[gid] = iter;
+        double3 color = sum / (double)(supersample * supersample);
+        int pixel = y * width + x;
+        iterations_out[pixel] = max_sample_iter;
         
-        if (iter < max_iter) {
-            double norm_iter = (double)iter / max_iter;
-            norm_iter = apply_log_smooth(norm_iter);
-            
-            double3 color;
-            switch (color_mode) {
-                case 0: color = rainbow_palette(norm_iter, color_shift); break;
-                case 1: color = fire_palette(norm_iter, color_shift); break;
-                case 2: color = electric_blue(norm_iter, color_shift); break;
-                case 3: color = twilight_palette(norm_iter, color_shift); break;
-                case 4: color = neon_palette(norm_iter, color_shift); break;
-                case 5: color = vintage_sepia(norm_iter, color_shift); break;
-                default: color = (double3)(0.0, 0.0, 0.0);
+        int idx = pixel * 3;
+        rgb_out[idx] = (uchar)(color.x * 255.0);
+        rgb_out[idx + 1] = (uchar)(color.y * 255.0);
+        rgb_out[idx + 2] = (uchar)(color.z * 255.0);
+    }
+    // One pass of the compacted scheme for high iteration limits. Each work-item
+    // advances one still-running pixel by up to `steps` iterations and shades it if it
+    // finished; survivors are written densely to active_out through a prefix sum over
+    // the work-group and one atomic per group, so the next pass launches only as many
+    // work-items as there are pixels left and no lane idles behind a slow neighbour.
+    // The first pass starts every pixel from z = 0 and ignores active_in. Rows with a
+    // pixel that finished are flagged in rows_resolved for progressive readback.
+    #define BATCH_GROUP_SIZE 64
+    __kernel __attribute__((reqd_work_group_size(BATCH_GROUP_SIZE, 1, 1)))
+    void mandelbrot_batch(__global int *iterations_out,
+                          __global uchar *rgb_out,
+                          __global double *x_array,
+                          __global double *y_array,
+                          const int width,
+                          const int max_iter,
+                          const int color_mode,
+                          const double color_shift,
+                          __global double *state_x,
+                          __global double *state_y,
+                          __global int *state_iter,
+                          __global int *active_out_count,
+                          __global const int *active_in,
+                          __global int *active_out,
+                          const int active_count,
+                          const int first_pass,
+                          const int steps,
+                          const double bailout_sq,
+                          const int smooth,
+                          __global uchar *rows_resolved)
+    {
+        __local int scan[BATCH_GROUP_SIZE];
+        __local int group_base;
+
+        int gid = get_global_id(0);
+        int lid = get_local_id(0);
+        int pixel = 0;
+        int survives = 0;
+
+        // Padding work-items past active_count still have to reach the barriers below
+        if (gid < active_count) {
+            pixel = first_pass ? gid : active_in[gid];
+            double x0 = x_array[pixel % width];
+            double y0 = y_array[pixel / width];
+            double x1 = first_pass ? 0.0 : state_x[pixel];
+            double y1 = first_pass ? 0.0 : state_y[pixel];
+            int iter = first_pass ? 0 : state_iter[pixel];
+            // Same loop as escape_iterations, so counts match the single-pass kernel
+            double x2 = x1 * x1;
+            double y2 = y1 * y1;
+            int limit = iter + min(steps, max_iter - iter);
+
+            while (x2 + y2 <= bailout_sq && iter < limit) {
+                y1 = 2.0 * x1 * y1 + y0;
+                x1 = x2 - y2 + x0;
+                x2 = x1 * x1;
+                y2 = y1 * y1;
+                iter++;
+            }
+
+            if (x2 + y2 <= bailout_sq && iter < max_iter) {
+                state_x[pixel] = x1;
+                state_y[pixel] = y1;
+                state_iter[pixel] = iter;
+                survives = 1;
+            } else {
+                iterations_out[pixel] = iter;
+                double value = escape_value(iter, x2 + y2, bailout_sq, smooth);
+                double3 color = shade(value, iter, max_iter, max_iter, color_mode, color_shift);
+                int idx = pixel * 3;
+                rgb_out[idx] = (uchar)(color.x * 255.0);
+                rgb_out[idx + 1] = (uchar)(color.y * 255.0);
+                rgb_out[idx + 2] = (uchar)(color.z * 255.0);
+                rows_resolved[pixel / width] = 1;
             }
-            
-            int idx = gid * 3;
-            rgb_out[idx] = (uchar)(color.x * 255.0);
-            rgb_out[idx + 1] = (uchar)(color.y * 255.0);
-            rgb_out[idx + 2] = (uchar)(color.z * 255.0);
-        } else {
-            int idx = gid * 3;
-            rgb_out[idx] = 0;
-            rgb_out[idx + 1] = 0;
-            rgb_out[idx + 2] = 0;
+        }
+
+        // Inclusive scan of the survivor flags across the work-group
+        scan[lid] = survives;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        for (int offset = 1; offset < BATCH_GROUP_SIZE; offset <<= 1) {
+            int add = lid >= offset ? scan[lid - offset] : 0;
+            barrier(CLK_LOCAL_MEM_FENCE);
+            scan[lid] += add;
+            barrier(CLK_LOCAL_MEM_FENCE);
+        }
+
+        if (lid == BATCH_GROUP_SIZE - 1) {
+            group_base = scan[lid] > 0 ? atomic_add(active_out_count, scan[lid]) : 0;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        if (survives) {
+            active_out[group_base + scan[lid] - 1] = pixel;
         }
     }
 )";
 
 MandelbrotViewer::MandelbrotViewer(int w, int h, int maxIter, int colorMode, double colorShift)
-    : width(w), height(h), maxIterations(maxIter), colorMode(colorMode)
+    : width(w), height(h), maxIterations(maxIter), zoom(1.0), centerX(-0.5), centerY(0.0), colorMode(colorMode),
+      bailout{2.0, false}
 {
     std::cout << "Initializing MandelbrotViewer with size " << width << "x" << height << std::endl;
     
@@ -150,8 +342,30 @@ MandelbrotViewer::MandelbrotViewer(int w, int h, int maxIter, int colorMode, dou
     }
 }
 
+MandelbrotViewer::MandelbrotViewer(const MandelbrotViewer& shared, int w, int h)
+    : width(w), height(h), maxIterations(shared.maxIterations), zoom(1.0), centerX(-0.5), centerY(0.0),
+      colorMode(shared.colorMode), colorShift(shared.colorShift), bailout(shared.bailout),
+      compactedPasses(shared.compactedPasses), context(shared.context), queue(shared.queue),
+      program(shared.program)
+{
+    imageData.resize(width * height * 3);
+    iterations.resize(width * height);
+    xArray.resize(width);
+    yArray.resize(height);
+
+    // Released again by the destructor
+    clRetainContext(context);
+    clRetainCommandQueue(queue);
+    clRetainProgram(program);
+    createBuffers();
+    createKernels();
+}
+
 MandelbrotViewer::~MandelbrotViewer() {
+    cancelBandedFrame();
     releaseBuffers();
+    clReleaseKernel(batchKernel);
+    clReleaseKernel(regionKernel);
     clReleaseKernel(kernel);
     clReleaseProgram(program);
     clReleaseCommandQueue(queue);
@@ -193,7 +407,8 @@ void MandelbrotViewer::initializeOpenCL() {
     }
 
     // Create command queue
-    queue = clCreateCommandQueue(context, device, 0, &err);
+    // Profiling lets traces show device-side transfer and kernel timings
+    queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &err);
     if (err != CL_SUCCESS) {
         std::cerr << "Failed to create command queue. Error code: " << err << std::endl;
         throw std::runtime_error("Failed to create command queue");
@@ -225,6 +440,41 @@ void MandelbrotViewer::releaseBuffers() {
     clReleaseMemObject(rgbBuffer);
     clReleaseMemObject(xArrayBuffer);
     clReleaseMemObject(yArrayBuffer);
+
+    cl_mem* batchBuffers[] = {&stateXBuffer, &stateYBuffer, &stateIterBuffer,
+                              &activeBuffers[0], &activeBuffers[1], &activeCountBuffer,
+                              &resolvedRowsBuffer};
+    for (cl_mem* buffer : batchBuffers) {
+        if (*buffer) {
+            clReleaseMemObject(*buffer);
+            *buffer = nullptr;
+        }
+    }
+}
+
+void MandelbrotViewer::createBatchBuffers() {
+    cl_int err;
+    size_t pixels = static_cast<size_t>(width) * height;
+
+    stateXBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, pixels * sizeof(double), nullptr, &err);
+    if (err != CL_SUCCESS) throw std::runtime_error("Failed to create batch state X buffer");
+
+    stateYBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, pixels * sizeof(double), nullptr, &err);
+    if (err != CL_SUCCESS) throw std::runtime_error("Failed to create batch state Y buffer");
+
+    stateIterBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, pixels * sizeof(int), nullptr, &err);
+    if (err != CL_SUCCESS) throw std::runtime_error("Failed to create batch iterations buffer");
+
+    for (cl_mem& active : activeBuffers) {
+        active = clCreateBuffer(context, CL_MEM_READ_WRITE, pixels * sizeof(int), nullptr, &err);
+        if (err != CL_SUCCESS) throw std::runtime_error("Failed to create active pixel buffer");
+    }
+
+    activeCountBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(int), nullptr, &err);
+    if (err != CL_SUCCESS) throw std::runtime_error("Failed to create active count buffer");
+
+    resolvedRowsBuffer = clCreateBuffer(context, CL_MEM_READ_WRITE, height, nullptr, &err);
+    if (err != CL_SUCCESS) throw std::runtime_error("Failed to create resolved rows buffer");
 }
 
 void MandelbrotViewer::compileKernel() {
@@ -248,9 +498,21 @@ void MandelbrotViewer::compileKernel() {
         throw std::runtime_error("Failed to build program: " + std::string(log.data()));
     }
 
+    createKernels();
+}
+
+void MandelbrotViewer::createKernels() {
+    cl_int err;
+
     kernel = clCreateKernel(program, "mandelbrot", &err);
     if (err != CL_SUCCESS) throw std::runtime_error("Failed to create kernel");
 
+    regionKernel = clCreateKernel(program, "mandelbrot_region", &err);
+    if (err != CL_SUCCESS) throw std::runtime_error("Failed to create region kernel");
+
+    batchKernel = clCreateKernel(program, "mandelbrot_batch", &err);
+    if (err != CL_SUCCESS) throw std::runtime_error("Failed to create batch kernel");
+
     // Set all kernel arguments immediately after creating the kernel
     if ((err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &iterationsBuffer)) != CL_SUCCESS ||
         (err = clSetKernelArg(kernel, 1, sizeof(cl_mem), &rgbBuffer)) != CL_SUCCESS ||
@@ -260,72 +522,551 @@ void MandelbrotViewer::compileKernel() {
         (err = clSetKernelArg(kernel, 5, sizeof(int), &height)) != CL_SUCCESS ||
         (err = clSetKernelArg(kernel, 6, sizeof(int), &maxIterations)) != CL_SUCCESS ||
         (err = clSetKernelArg(kernel, 7, sizeof(int), &colorMode)) != CL_SUCCESS ||
-        (err = clSetKernelArg(kernel, 8, sizeof(double), &colorShift)) != CL_SUCCESS) {
+        (err = clSetKernelArg(kernel, 8, sizeof(double), &colorShift)) != CL_SUCCESS ||
+        !setBailoutArgs(kernel, 9, bailout)) {
         std::cerr << "Failed to set initial kernel arguments. Error code: " << err << std::endl;
         throw std::runtime_error("Failed to set initial kernel arguments");
     }
 }
 
 void MandelbrotViewer::computeFrame(double centerX, double centerY, double zoom) {
-    try {
-        // Calculate coordinate arrays
-        double aspectRatio = static_cast<double>(width) / height;
-        double scale = 4.0 / zoom;
-        
-        for (int x = 0; x < width; ++x) {
-            xArray[x] = centerX + (x - width/2.0) * scale / width * aspectRatio;
-        }
-        
-        for (int y = 0; y < height; ++y) {
-            yArray[y] = centerY + (y - height/2.0) * scale / height;
+    // Remember the view so resize() can re-render it
+    this->centerX = centerX;
+    this->centerY = centerY;
+    this->zoom = zoom;
+
+    cancelBandedFrame();
+    progressiveActive = false;
+    TRACE_SCOPE("opencl", "computeFrame");
+    auto frameStart = std::chrono::steady_clock::now();
+    // Device events are only collected while a trace is being recorded
+    const bool tracing = Trace::isEnabled();
+    std::vector<cl_event> deviceEvents;
+    std::vector<const char*> eventNames;
+    // Returns where the next command's event goes, or nullptr when not tracing
+    auto nextEvent = [&](const char* name) -> cl_event* {
+        if (!tracing) {
+            return nullptr;
         }
+        deviceEvents.push_back(nullptr);
+        eventNames.push_back(name);
+        return &deviceEvents.back();
+    };
+
+    try {
+        fillCoordinates();
 
         // Copy coordinate arrays to device
         cl_int err = clEnqueueWriteBuffer(queue, xArrayBuffer, CL_TRUE, 0,
-            width * sizeof(double), xArray.data(), 0, nullptr, nullptr);
+            width * sizeof(double), xArray.data(), 0, nullptr, nextEvent("write x array"));
         if (err != CL_SUCCESS) {
             std::cerr << "Failed to write X array. Error code: " << err << std::endl;
             throw std::runtime_error("Failed to write X array");
         }
 
         err = clEnqueueWriteBuffer(queue, yArrayBuffer, CL_TRUE, 0,
-            height * sizeof(double), yArray.data(), 0, nullptr, nullptr);
+            height * sizeof(double), yArray.data(), 0, nullptr, nextEvent("write y array"));
         if (err != CL_SUCCESS) {
             std::cerr << "Failed to write Y array. Error code: " << err << std::endl;
             throw std::runtime_error("Failed to write Y array");
         }
 
-        // Update only the arguments that can change during runtime
-        cl_int argErr;
-        if ((argErr = clSetKernelArg(kernel, 6, sizeof(int), &maxIterations)) != CL_SUCCESS ||
-            (argErr = clSetKernelArg(kernel, 7, sizeof(int), &colorMode)) != CL_SUCCESS ||
-            (argErr = clSetKernelArg(kernel, 8, sizeof(double), &colorShift)) != CL_SUCCESS) {
-            std::cerr << "Failed to set kernel argument. Error code: " << argErr << std::endl;
-            throw std::runtime_error("Failed to set kernel argument");
-        }
+        if (compactedPasses && maxIterations >= BATCH_MIN_ITERATIONS) {
+            runBatchedPasses(tracing, deviceEvents, eventNames);
+        } else {
+            // Update only the arguments that can change during runtime
+            cl_int argErr;
+            if ((argErr = clSetKernelArg(kernel, 6, sizeof(int), &maxIterations)) != CL_SUCCESS ||
+                (argErr = clSetKernelArg(kernel, 7, sizeof(int), &colorMode)) != CL_SUCCESS ||
+                (argErr = clSetKernelArg(kernel, 8, sizeof(double), &colorShift)) != CL_SUCCESS ||
+                !setBailoutArgs(kernel, 9, bailout)) {
+                std::cerr << "Failed to set kernel argument. Error code: " << argErr << std::endl;
+                throw std::runtime_error("Failed to set kernel argument");
+            }
 
-        // Execute kernel
-        size_t globalSize = width * height;
-        err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalSize, nullptr, 0, nullptr, nullptr);
-        if (err != CL_SUCCESS) {
-            std::cerr << "Failed to execute kernel. Error code: " << err << std::endl;
-            throw std::runtime_error("Failed to execute kernel");
+            // Execute kernel
+            size_t globalSize = width * height;
+            err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &globalSize, nullptr, 0, nullptr,
+                nextEvent("mandelbrot kernel"));
+            if (err != CL_SUCCESS) {
+                std::cerr << "Failed to execute kernel. Error code: " << err << std::endl;
+                throw std::runtime_error("Failed to execute kernel");
+            }
         }
 
         // Read results
         err = clEnqueueReadBuffer(queue, rgbBuffer, CL_TRUE, 0,
-            width * height * 3 * sizeof(unsigned char), imageData.data(), 0, nullptr, nullptr);
+            width * height * 3 * sizeof(unsigned char), imageData.data(), 0, nullptr,
+            nextEvent("read rgb"));
         if (err != CL_SUCCESS) {
             std::cerr << "Failed to read RGB buffer. Error code: " << err << std::endl;
             throw std::runtime_error("Failed to read RGB buffer");
         }
+
+        Metrics::framesRendered.add();
+        Metrics::openclFrameLatency.observe(std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - frameStart).count());
+
+        if (tracing) {
+            traceDeviceEvents(deviceEvents.data(), eventNames.data(), static_cast<int>(deviceEvents.size()));
+        }
     }
     catch (const std::exception& e) {
+        for (cl_event event : deviceEvents) {
+            if (event) clReleaseEvent(event);
+        }
         std::cerr << "Error in computeFrame: " << e.what() << std::endl;
         throw;
     }
 }
 
+void MandelbrotViewer::fillCoordinates() {
+    double aspectRatio = static_cast<double>(width) / height;
+    double scale = 4.0 / zoom;
+
+    for (int x = 0; x < width; ++x) {
+        xArray[x] = centerX + (x - width/2.0) * scale / width * aspectRatio;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        yArray[y] = centerY + (y - height/2.0) * scale / height;
+    }
+}
+
+void MandelbrotViewer::setView(double centerX, double centerY, double zoom) {
+    cancelBandedFrame();
+    progressiveActive = false;
+    this->centerX = centerX;
+    this->centerY = centerY;
+    this->zoom = zoom;
+    fillCoordinates();
+
+    cl_int err = clEnqueueWriteBuffer(queue, xArrayBuffer, CL_TRUE, 0,
+        width * sizeof(double), xArray.data(), 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to write X array. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to write X array");
+    }
+
+    err = clEnqueueWriteBuffer(queue, yArrayBuffer, CL_TRUE, 0,
+        height * sizeof(double), yArray.data(), 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to write Y array. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to write Y array");
+    }
+}
+
+void MandelbrotViewer::beginBandedFrame(double centerX, double centerY, double zoom) {
+    cancelBandedFrame();
+    progressiveActive = false;
+    TRACE_SCOPE("opencl", "beginBandedFrame");
+    this->centerX = centerX;
+    this->centerY = centerY;
+    this->zoom = zoom;
+    bandedFrameStart = std::chrono::steady_clock::now();
+
+    fillCoordinates();
+    cl_int err = clEnqueueWriteBuffer(queue, xArrayBuffer, CL_TRUE, 0, width * sizeof(double), xArray.data(),
+                                      0, nullptr, nullptr);
+    if (err == CL_SUCCESS) {
+        err = clEnqueueWriteBuffer(queue, yArrayBuffer, CL_TRUE, 0, height * sizeof(double), yArray.data(),
+                                   0, nullptr, nullptr);
+    }
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to write coordinate arrays. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to write coordinate arrays");
+    }
+
+    // Argument values are captured at each launch, so setting them once covers every band
+    if ((err = clSetKernelArg(kernel, 6, sizeof(int), &maxIterations)) != CL_SUCCESS ||
+        (err = clSetKernelArg(kernel, 7, sizeof(int), &colorMode)) != CL_SUCCESS ||
+        (err = clSetKernelArg(kernel, 8, sizeof(double), &colorShift)) != CL_SUCCESS ||
+        !setBailoutArgs(kernel, 9, bailout)) {
+        std::cerr << "Failed to set kernel argument. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to set kernel argument");
+    }
+
+    // Centre band first, then alternately above and below it, where the eye usually is
+    int bandCount = (height + BAND_ROWS - 1) / BAND_ROWS;
+    int middle = (height / 2) / BAND_ROWS;
+    std::vector<int> order(bandCount);
+    for (int band = 0; band < bandCount; ++band) {
+        order[band] = band;
+    }
+    auto launchRank = [middle](int band) { return 2 * std::abs(band - middle) - (band < middle ? 1 : 0); };
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return launchRank(a) < launchRank(b); });
+    for (int band : order) {
+        pendingBands.emplace_back(band * BAND_ROWS, std::min(height, (band + 1) * BAND_ROWS));
+    }
+    while (!pendingBands.empty() && launchedBands.size() < MAX_BANDS_LAUNCHED) {
+        launchBand(pendingBands.front().first, pendingBands.front().second);
+        pendingBands.pop_front();
+    }
+    clFlush(queue);
+}
+
+void MandelbrotViewer::launchBand(int rowBegin, int rowEnd) {
+    size_t offset = static_cast<size_t>(rowBegin) * width;
+    size_t globalSize = static_cast<size_t>(rowEnd - rowBegin) * width;
+    cl_int err = clEnqueueNDRangeKernel(queue, kernel, 1, &offset, &globalSize, nullptr, 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to execute band kernel. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to execute band kernel");
+    }
+
+    // Non-blocking: the rows of imageData are left alone until the event completes
+    cl_event done = nullptr;
+    err = clEnqueueReadBuffer(queue, rgbBuffer, CL_FALSE, offset * 3, globalSize * 3,
+                              imageData.data() + offset * 3, 0, nullptr, &done);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to read band. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to read band");
+    }
+    launchedBands.push_back({rowBegin, rowEnd, done});
+}
+
+bool MandelbrotViewer::pollBandedFrame(std::vector<std::pair<int, int>>& finishedRows) {
+    if (!bandedFrameActive()) {
+        return true;
+    }
+
+    // The queue is in order, so bands complete in launch order
+    bool launched = false;
+    while (!launchedBands.empty()) {
+        cl_int status = CL_QUEUED;
+        clGetEventInfo(launchedBands.front().done, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, nullptr);
+        if (status < 0) {
+            std::cerr << "Band read failed. Error code: " << status << std::endl;
+            cancelBandedFrame();
+            throw std::runtime_error("Band read failed");
+        }
+        if (status != CL_COMPLETE) {
+            break;
+        }
+        LaunchedBand band = launchedBands.front();
+        launchedBands.pop_front();
+        clReleaseEvent(band.done);
+        finishedRows.emplace_back(band.rowBegin, band.rowEnd);
+
+        if (!pendingBands.empty()) {
+            launchBand(pendingBands.front().first, pendingBands.front().second);
+            pendingBands.pop_front();
+            launched = true;
+        }
+    }
+    if (launched) {
+        clFlush(queue);
+    }
+
+    if (bandedFrameActive()) {
+        return false;
+    }
+    Metrics::framesRendered.add();
+    Metrics::openclFrameLatency.observe(std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - bandedFrameStart).count());
+    return true;
+}
+
+void MandelbrotViewer::cancelBandedFrame() {
+    pendingBands.clear();
+    if (launchedBands.empty()) {
+        return;
+    }
+    TRACE_SCOPE("opencl", "cancelBandedFrame");
+    clFinish(queue);
+    for (const LaunchedBand& band : launchedBands) {
+        clReleaseEvent(band.done);
+    }
+    launchedBands.clear();
+}
+
+void MandelbrotViewer::startBatchedPasses() {
+    if (!stateXBuffer) {
+        createBatchBuffers();
+    }
+
+    cl_int err;
+    if ((err = clSetKernelArg(batchKernel, 0, sizeof(cl_mem), &iterationsBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 1, sizeof(cl_mem), &rgbBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 2, sizeof(cl_mem), &xArrayBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 3, sizeof(cl_mem), &yArrayBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 4, sizeof(int), &width)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 5, sizeof(int), &maxIterations)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 6, sizeof(int), &colorMode)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 7, sizeof(double), &colorShift)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 8, sizeof(cl_mem), &stateXBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 9, sizeof(cl_mem), &stateYBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 10, sizeof(cl_mem), &stateIterBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 11, sizeof(cl_mem), &activeCountBuffer)) != CL_SUCCESS ||
+        !setBailoutArgs(batchKernel, 17, bailout) ||
+        (err = clSetKernelArg(batchKernel, 19, sizeof(cl_mem), &resolvedRowsBuffer)) != CL_SUCCESS) {
+        std::cerr << "Failed to set batch kernel arguments. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to set batch kernel arguments");
+    }
+
+    batchActiveCount = width * height;
+    batchCurrent = 0;
+    batchFirstPass = 1;
+    batchSteps = FIRST_BATCH_STEPS;
+    batchIterationsDone = 0;
+}
+
+void MandelbrotViewer::runBatchPass(int steps, cl_event* event) {
+    // In-order queue: the reset lands before the kernel, and the blocking read below
+    // keeps `zero` alive until it has been copied
+    const int zero = 0;
+    cl_int err = clEnqueueWriteBuffer(queue, activeCountBuffer, CL_FALSE, 0, sizeof(int), &zero, 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to reset active count. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to reset active count");
+    }
+
+    if ((err = clSetKernelArg(batchKernel, 12, sizeof(cl_mem), &activeBuffers[batchCurrent])) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 13, sizeof(cl_mem), &activeBuffers[1 - batchCurrent])) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 14, sizeof(int), &batchActiveCount)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 15, sizeof(int), &batchFirstPass)) != CL_SUCCESS ||
+        (err = clSetKernelArg(batchKernel, 16, sizeof(int), &steps)) != CL_SUCCESS) {
+        std::cerr << "Failed to set batch kernel arguments. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to set batch kernel arguments");
+    }
+
+    size_t localSize = BATCH_GROUP_SIZE;
+    size_t globalSize = (static_cast<size_t>(batchActiveCount) + localSize - 1) / localSize * localSize;
+    err = clEnqueueNDRangeKernel(queue, batchKernel, 1, nullptr, &globalSize, &localSize, 0, nullptr, event);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to execute batch kernel. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to execute batch kernel");
+    }
+
+    // The survivor count sizes the next launch
+    err = clEnqueueReadBuffer(queue, activeCountBuffer, CL_TRUE, 0, sizeof(int), &batchActiveCount, 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to read active count. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to read active count");
+    }
+
+    batchCurrent = 1 - batchCurrent;
+    batchFirstPass = 0;
+    batchIterationsDone += steps;
+}
+
+void MandelbrotViewer::runBatchedPasses(bool tracing, std::vector<cl_event>& events,
+                                        std::vector<const char*>& names) {
+    startBatchedPasses();
+    while (batchActiveCount > 0) {
+        cl_event* event = nullptr;
+        if (tracing) {
+            events.push_back(nullptr);
+            names.push_back("mandelbrot batch kernel");
+            event = &events.back();
+        }
+        runBatchPass(batchSteps, event);
+        batchSteps = std::min(batchSteps * 2, MAX_BATCH_STEPS);
+    }
+}
+
+void MandelbrotViewer::beginProgressiveFrame(double centerX, double centerY, double zoom) {
+    cancelBandedFrame();
+    TRACE_SCOPE("opencl", "beginProgressiveFrame");
+    this->centerX = centerX;
+    this->centerY = centerY;
+    this->zoom = zoom;
+    progressiveFrameStart = std::chrono::steady_clock::now();
+
+    fillCoordinates();
+    cl_int err = clEnqueueWriteBuffer(queue, xArrayBuffer, CL_TRUE, 0, width * sizeof(double), xArray.data(),
+                                      0, nullptr, nullptr);
+    if (err == CL_SUCCESS) {
+        err = clEnqueueWriteBuffer(queue, yArrayBuffer, CL_TRUE, 0, height * sizeof(double), yArray.data(),
+                                   0, nullptr, nullptr);
+    }
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to write coordinate arrays. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to write coordinate arrays");
+    }
+
+    // Pixels only get a colour once they finish; until then they show as interior. The
+    // image is cleared on both sides, since only rows with resolved pixels are read back.
+    const unsigned char black = 0;
+    err = clEnqueueFillBuffer(queue, rgbBuffer, &black, sizeof(black), 0,
+                              static_cast<size_t>(width) * height * 3, 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to clear RGB buffer. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to clear RGB buffer");
+    }
+    std::fill(imageData.begin(), imageData.end(), 0);
+
+    startBatchedPasses();
+    clearResolvedRows();
+    progressiveActive = true;
+}
+
+void MandelbrotViewer::clearResolvedRows() {
+    const unsigned char unset = 0;
+    cl_int err = clEnqueueFillBuffer(queue, resolvedRowsBuffer, &unset, sizeof(unset), 0, height,
+                                     0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to clear resolved rows. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to clear resolved rows");
+    }
+}
+
+bool MandelbrotViewer::continueProgressiveFrame(int iterationBudget, std::vector<std::pair<int, int>>& resolvedRows) {
+    if (!progressiveActive) {
+        return true;
+    }
+    TRACE_SCOPE("opencl", "continueProgressiveFrame");
+
+    // Same doubling schedule as a full compacted frame, cut off at the budget
+    int spent = 0;
+    while (batchActiveCount > 0 && spent < iterationBudget) {
+        int steps = std::min(batchSteps, iterationBudget - spent);
+        runBatchPass(steps, nullptr);
+        spent += steps;
+        batchSteps = std::min(batchSteps * 2, MAX_BATCH_STEPS);
+    }
+
+    // Late passes resolve few pixels, so only the rows they touched are read back
+    std::vector<unsigned char> rowFlags(height);
+    cl_int err = clEnqueueReadBuffer(queue, resolvedRowsBuffer, CL_TRUE, 0, height, rowFlags.data(),
+                                     0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        std::cerr << "Failed to read resolved rows. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to read resolved rows");
+    }
+    size_t rowPitch = static_cast<size_t>(width) * 3;
+    for (int row = 0; row < height; ) {
+        if (!rowFlags[row]) {
+            ++row;
+            continue;
+        }
+        int end = row + 1;
+        while (end < height && rowFlags[end]) {
+            ++end;
+        }
+        size_t offset = row * rowPitch;
+        err = clEnqueueReadBuffer(queue, rgbBuffer, CL_FALSE, offset, (end - row) * rowPitch,
+                                  imageData.data() + offset, 0, nullptr, nullptr);
+        if (err != CL_SUCCESS) {
+            std::cerr << "Failed to read RGB rows. Error code: " << err << std::endl;
+            throw std::runtime_error("Failed to read RGB rows");
+        }
+        resolvedRows.emplace_back(row, end);
+        row = end;
+    }
+    clearResolvedRows();
+    clFinish(queue);
+
+    if (batchActiveCount > 0) {
+        return false;
+    }
+    progressiveActive = false;
+    Metrics::framesRendered.add();
+    Metrics::openclFrameLatency.observe(std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - progressiveFrameStart).count());
+    return true;
+}
+
+void MandelbrotViewer::traceDeviceEvents(cl_event* events, const char* const* names, int count) {
+    // Device timestamps use their own clock; anchor the end of the last command to now,
+    // which is just after the blocking read returned
+    cl_ulong deviceEnd = 0;
+    clGetEventProfilingInfo(events[count - 1], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &deviceEnd, nullptr);
+    uint64_t hostEnd = Trace::now();
+
+    for (int i = 0; i < count; ++i) {
+        cl_ulong queued = 0, start = 0, end = 0;
+        if (clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &queued, nullptr) == CL_SUCCESS &&
+            clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, nullptr) == CL_SUCCESS &&
+            clGetEventProfilingInfo(events[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, nullptr) == CL_SUCCESS &&
+            deviceEnd >= start && end >= start) {
+            uint64_t hostStart = hostEnd - std::min<uint64_t>(hostEnd, (deviceEnd - start) / 1000);
+            const char* category = std::strstr(names[i], "kernel") ? "kernel" : "transfer";
+            Trace::completeOnTrack(Trace::DEVICE_TRACK, category, names[i], hostStart, (end - start) / 1000,
+                "\"queuedUs\": " + std::to_string((start - queued) / 1000));
+        }
+        clReleaseEvent(events[i]);
+        events[i] = nullptr;
+    }
+}
+
+void MandelbrotViewer::computeRegion(int regionX, int regionY, int regionW, int regionH,
+                                     int regionMaxIter, int supersample, const BailoutSettings& regionBailout) {
+    cancelBandedFrame();
+    progressiveActive = false;
+    TRACE_SCOPE("opencl", "computeRegion");
+    // Clip the region to the frame
+    int x0 = std::max(regionX, 0);
+    int y0 = std::max(regionY, 0);
+    int x1 = std::min(regionX + regionW, width);
+    int y1 = std::min(regionY + regionH, height);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    regionW = x1 - x0;
+    regionH = y1 - y0;
+    supersample = std::max(supersample, 1);
+
+    // Sub-pixel offsets are relative to the coordinate arrays of the last computeFrame
+    double aspectRatio = static_cast<double>(width) / height;
+    double scale = 4.0 / zoom;
+    double stepX = scale / width * aspectRatio;
+    double stepY = scale / height;
+
+    cl_int err;
+    if ((err = clSetKernelArg(regionKernel, 0, sizeof(cl_mem), &iterationsBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 1, sizeof(cl_mem), &rgbBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 2, sizeof(cl_mem), &xArrayBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 3, sizeof(cl_mem), &yArrayBuffer)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 4, sizeof(int), &width)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 5, sizeof(int), &x0)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 7, sizeof(int), &regionW)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 9, sizeof(int), &regionMaxIter)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 10, sizeof(int), &maxIterations)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 11, sizeof(int), &colorMode)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 12, sizeof(double), &colorShift)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 13, sizeof(int), &supersample)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 14, sizeof(double), &stepX)) != CL_SUCCESS ||
+        (err = clSetKernelArg(regionKernel, 15, sizeof(double), &stepY)) != CL_SUCCESS ||
+        !setBailoutArgs(regionKernel, 16, regionBailout)) {
+        std::cerr << "Failed to set region kernel arguments. Error code: " << err << std::endl;
+        throw std::runtime_error("Failed to set region kernel arguments");
+    }
+
+    // Launch in row chunks of no more samples than a banded-frame band, each finished
+    // before the next, so a full-frame supersampled export can't trip the GPU watchdog
+    const size_t samplesPerRow = static_cast<size_t>(regionW) * supersample * supersample;
+    const int chunkRows = static_cast<int>(std::max<size_t>(
+        1, static_cast<size_t>(BAND_ROWS) * width / samplesPerRow));
+    size_t localSize = 64;
+    size_t rowPitch = static_cast<size_t>(width) * 3;
+    for (int chunkY = y0; chunkY < y1; chunkY += chunkRows) {
+        int chunkH = std::min(chunkRows, y1 - chunkY);
+        if ((err = clSetKernelArg(regionKernel, 6, sizeof(int), &chunkY)) != CL_SUCCESS ||
+            (err = clSetKernelArg(regionKernel, 8, sizeof(int), &chunkH)) != CL_SUCCESS) {
+            std::cerr << "Failed to set region kernel arguments. Error code: " << err << std::endl;
+            throw std::runtime_error("Failed to set region kernel arguments");
+        }
+
+        size_t globalSize = ((static_cast<size_t>(regionW) * chunkH + localSize - 1) / localSize) * localSize;
+        err = clEnqueueNDRangeKernel(queue, regionKernel, 1, nullptr, &globalSize, &localSize, 0, nullptr, nullptr);
+        if (err != CL_SUCCESS) {
+            std::cerr << "Failed to execute region kernel. Error code: " << err << std::endl;
+            throw std::runtime_error("Failed to execute region kernel");
+        }
+
+        // Read back only the rows of the chunk, leaving the rest of the image untouched
+        size_t origin[3] = {static_cast<size_t>(x0) * 3, static_cast<size_t>(chunkY), 0};
+        size_t region[3] = {static_cast<size_t>(regionW) * 3, static_cast<size_t>(chunkH), 1};
+        err = clEnqueueReadBufferRect(queue, rgbBuffer, CL_TRUE, origin, origin, region,
+            rowPitch, 0, rowPitch, 0, imageData.data(), 0, nullptr, nullptr);
+        if (err != CL_SUCCESS) {
+            std::cerr << "Failed to read RGB region. Error code: " << err << std::endl;
+            throw std::runtime_error("Failed to read RGB region");
+        }
+    }
+}
+
 void MandelbrotViewer::setColorMode(int mode) {
     colorMode = mode;
 }
@@ -334,9 +1075,22 @@ void MandelbrotViewer::setColorShift(double shift) {
     colorShift = shift;
 }
 
+void MandelbrotViewer::setBailout(const BailoutSettings& settings) {
+    bailout = settings;
+}
+
+bool MandelbrotViewer::setBailoutArgs(cl_kernel target, cl_uint firstArg, const BailoutSettings& settings) {
+    // Below 2 points outside the set could stop iterating before they provably escape
+    double radius = std::max(settings.radius, 2.0);
+    double bailoutSquared = radius * radius;
+    int smooth = settings.smoothColoring ? 1 : 0;
+    return clSetKernelArg(target, firstArg, sizeof(double), &bailoutSquared) == CL_SUCCESS &&
+           clSetKernelArg(target, firstArg + 1, sizeof(int), &smooth) == CL_SUCCESS;
+}
+
 void MandelbrotViewer::setMaxIterations(int maxIter) {
+    // Takes effect on the next computeFrame, so repeated calls don't re-run the kernel
     maxIterations = maxIter;
-    updateImage();
 }
 
 void MandelbrotViewer::resize(int newWidth, int newHeight) {
@@ -344,6 +1098,9 @@ void MandelbrotViewer::resize(int newWidth, int newHeight) {
         return;
     }
 
+    cancelBandedFrame();
+    progressiveActive = false;
+
     // Store the center point before resize
     double oldCenterX = centerX;
     double oldCenterY = centerY;
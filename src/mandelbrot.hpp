@@ -2,23 +2,81 @@
 
 #include <vector>
 #include <string>
+#include <deque>
+#include <utility>
+#include <chrono>
 #include <CL/cl.h>
 #include "color_palettes.hpp"
+#include "frame_memory.hpp"
+
+// Escape radius and colouring used for one kind of render
+struct BailoutSettings {
+    double radius;        // At least 2; a larger radius costs a few iterations per pixel
+    bool smoothColoring;  // Continuous escape count instead of integer bands
+};
 
 class MandelbrotViewer {
 public:
     MandelbrotViewer(int width, int height, int maxIterations, int colorMode, double colorShift);
+    // A second frame of its own size on shared's OpenCL context, queue and program, so it
+    // costs buffer allocations rather than a new context and kernel compile. Starts with
+    // shared's render settings.
+    MandelbrotViewer(const MandelbrotViewer& shared, int width, int height);
     ~MandelbrotViewer();
     
     void computeFrame(double centerX, double centerY, double zoom);
+
+    // Asynchronous alternative to computeFrame for the hybrid preview. The frame is split
+    // into bands of rows, launched centre first a couple at a time, so results arrive band
+    // by band without blocking, and a frame the view has moved on from costs only the
+    // bands already on the device. Always uses the single-pass kernel.
+    void beginBandedFrame(double centerX, double centerY, double zoom);
+    // Launches further bands as earlier ones finish and appends the [begin, end) row
+    // ranges whose colours are now in getImageData(); true once the frame is complete
+    bool pollBandedFrame(std::vector<std::pair<int, int>>& finishedRows);
+    // Waits for the bands already launched and drops the rest. Every other render call
+    // does this first, since band results are read straight into the image.
+    void cancelBandedFrame();
+    bool bandedFrameActive() const { return !pendingBands.empty() || !launchedBands.empty(); }
+
+    // Iteration-budget frames: the compacted passes spread over several calls, each
+    // advancing every unresolved pixel by at most iterationBudget iterations, so a frame
+    // at a huge limit sharpens over many displayed frames instead of blocking for one.
+    // Pixels still running show as interior. Any other render call abandons the frame.
+    // These frames always use the compacted passes, whatever setCompactedPasses says,
+    // since the pixel state they keep between calls only exists in that scheme.
+    void beginProgressiveFrame(double centerX, double centerY, double zoom);
+    // Runs the next passes, reads back the rows where pixels resolved and appends them
+    // as [begin, end) ranges; true once every pixel has resolved
+    bool continueProgressiveFrame(int iterationBudget, std::vector<std::pair<int, int>>& resolvedRows);
+    bool progressiveFrameActive() const { return progressiveActive; }
+    // Iterations every unresolved pixel has had so far, and how many are left
+    int getProgressiveIterations() const { return batchIterationsDone; }
+    int getUnresolvedPixels() const { return batchActiveCount; }
+    // Sets the view and uploads its coordinates without rendering, for a frame drawn
+    // entirely by computeRegion (a supersampled export) so no full pass is wasted
+    void setView(double centerX, double centerY, double zoom);
+    // Re-render a sub-rectangle of the last frame at a higher iteration limit
+    // and supersampling factor, merging it into the current image
+    void computeRegion(int regionX, int regionY, int regionW, int regionH,
+                       int regionMaxIter, int supersample, const BailoutSettings& regionBailout);
     void setColorMode(int mode);
     void setColorShift(double shift);
+    // Used from the next computeFrame; defaults to radius 2 with banded colours, which
+    // matches the CPU tile renderer
+    void setBailout(const BailoutSettings& settings);
+    // Whether high iteration limits use the compacted multi-pass kernel (the default)
+    void setCompactedPasses(bool enabled) { compactedPasses = enabled; }
     void setMaxIterations(int maxIter);
     int getMaxIterations() const;
     
-    const std::vector<unsigned char>& getImageData() const { return imageData; }
+    const FrameVector<unsigned char>& getImageData() const { return imageData; }
     int getWidth() const { return width; }
     int getHeight() const { return height; }
+    // View of the last computeFrame or beginBandedFrame
+    double getCenterX() const { return centerX; }
+    double getCenterY() const { return centerY; }
+    double getZoom() const { return zoom; }
     
     void resize(int newWidth, int newHeight);
 
@@ -27,7 +85,17 @@ private:
     void createBuffers();
     void releaseBuffers();
     void compileKernel();
+    void createKernels();
+    void createBatchBuffers();
+    void startBatchedPasses();
+    void runBatchPass(int steps, cl_event* event);
+    void runBatchedPasses(bool tracing, std::vector<cl_event>& events, std::vector<const char*>& names);
     void updateImage();
+    bool setBailoutArgs(cl_kernel target, cl_uint firstArg, const BailoutSettings& settings);
+    void fillCoordinates();
+    void launchBand(int rowBegin, int rowEnd);
+    void clearResolvedRows();
+    void traceDeviceEvents(cl_event* events, const char* const* names, int count);
 
     int width;
     int height;
@@ -40,20 +108,53 @@ private:
     double centerY;
     int colorMode;
     double colorShift;
+    BailoutSettings bailout;
+    bool compactedPasses = true;
 
     // OpenCL resources
     cl_context context;
     cl_command_queue queue;
     cl_program program;
     cl_kernel kernel;
+    cl_kernel regionKernel;
+    cl_kernel batchKernel;
     cl_mem iterationsBuffer;
     cl_mem rgbBuffer;
     cl_mem xArrayBuffer;
     cl_mem yArrayBuffer;
     cl_mem imageBuffer;
+    // Per-pixel z and count between passes of batchKernel, and the ping-pong lists of
+    // pixels still running; only created once a frame needs them
+    cl_mem stateXBuffer = nullptr;
+    cl_mem stateYBuffer = nullptr;
+    cl_mem stateIterBuffer = nullptr;
+    cl_mem activeBuffers[2] = {nullptr, nullptr};
+    cl_mem activeCountBuffer = nullptr;
+    // One flag per row, set by batchKernel when a pixel in the row finishes
+    cl_mem resolvedRowsBuffer = nullptr;
+
+    // Compacted pass state, kept between calls for progressive frames
+    int batchActiveCount = 0;
+    int batchCurrent = 0;
+    int batchFirstPass = 1;
+    int batchSteps = 0;
+    int batchIterationsDone = 0;
+    bool progressiveActive = false;
+    std::chrono::steady_clock::time_point progressiveFrameStart;
+
+    // Banded frame in progress: rows still to launch, and launched bands with the event
+    // of the read that completes each
+    struct LaunchedBand {
+        int rowBegin;
+        int rowEnd;
+        cl_event done;
+    };
+    std::deque<std::pair<int, int>> pendingBands;
+    std::deque<LaunchedBand> launchedBands;
+    std::chrono::steady_clock::time_point bandedFrameStart;
 
-    std::vector<unsigned char> imageData;
-    std::vector<int> iterations;
+    FrameVector<unsigned char> imageData;
+    FrameVector<int> iterations;
     std::vector<double> xArray;
     std::vector<double> yArray;
 
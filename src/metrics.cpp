@@ -0,0 +1,272 @@
+#include "metrics.hpp"
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define CLOSE_SOCKET closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define CLOSE_SOCKET close
+#endif
+
+namespace Metrics {
+
+namespace {
+
+std::vector<Metric*>& registry() {
+    static std::vector<Metric*> metrics;
+    return metrics;
+}
+
+std::atomic<int> nextShard(0);
+
+const double BUCKET_BOUNDS[Histogram::BUCKET_COUNT] = {
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+};
+
+// A client that connects and then goes quiet is dropped after this long
+const int CLIENT_TIMEOUT_MS = 1000;
+
+template <typename Socket>
+void setClientTimeouts(Socket client) {
+#ifdef _WIN32
+    DWORD timeout = CLIENT_TIMEOUT_MS;
+#else
+    timeval timeout = {CLIENT_TIMEOUT_MS / 1000, (CLIENT_TIMEOUT_MS % 1000) * 1000};
+#endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+} // namespace
+
+int threadShard() {
+    thread_local int shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+    return shard;
+}
+
+Metric::Metric(const char* name, const char* help, const char* type, const char* labels)
+    : name(name), help(help), type(type), labels(labels)
+{
+    registry().push_back(this);
+}
+
+std::string Metric::fullName() const {
+    std::string result = name;
+    if (labels[0] != '\0') {
+        result += "{" + std::string(labels) + "}";
+    }
+    return result;
+}
+
+Counter::Counter(const char* name, const char* help, const char* labels)
+    : Metric(name, help, "counter", labels)
+{
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void Counter::write(std::string& out) const {
+    out += fullName() + " " + std::to_string(value()) + "\n";
+}
+
+Gauge::Gauge(const char* name, const char* help, const char* labels)
+    : Metric(name, help, "gauge", labels)
+{
+}
+
+void Gauge::write(std::string& out) const {
+    out += fullName() + " " + std::to_string(current.load(std::memory_order_relaxed)) + "\n";
+}
+
+Histogram::Histogram(const char* name, const char* help, const char* labels)
+    : Metric(name, help, "histogram", labels)
+{
+    for (Shard& shard : shards) {
+        for (auto& bucket : shard.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Histogram::observe(double seconds) {
+    int bucket = 0;
+    while (bucket < BUCKET_COUNT && seconds > BUCKET_BOUNDS[bucket]) {
+        ++bucket;
+    }
+    Shard& shard = shards[threadShard()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sumMicros.fetch_add(static_cast<uint64_t>(seconds * 1.0e6), std::memory_order_relaxed);
+}
+
+void Histogram::write(std::string& out) const {
+    std::string labelPrefix = labels[0] != '\0' ? std::string(labels) + "," : "";
+
+    uint64_t cumulative = 0;
+    uint64_t sumMicros = 0;
+    for (int bucket = 0; bucket <= BUCKET_COUNT; ++bucket) {
+        for (const Shard& shard : shards) {
+            cumulative += shard.buckets[bucket].load(std::memory_order_relaxed);
+        }
+
+        char bound[32];
+        if (bucket < BUCKET_COUNT) {
+            std::snprintf(bound, sizeof(bound), "%g", BUCKET_BOUNDS[bucket]);
+        } else {
+            std::snprintf(bound, sizeof(bound), "+Inf");
+        }
+        out += std::string(name) + "_bucket{" + labelPrefix + "le=\"" + bound + "\"} " +
+               std::to_string(cumulative) + "\n";
+    }
+    for (const Shard& shard : shards) {
+        sumMicros += shard.sumMicros.load(std::memory_order_relaxed);
+    }
+
+    std::string suffix = labels[0] != '\0' ? "{" + std::string(labels) + "}" : "";
+    out += std::string(name) + "_sum" + suffix + " " + std::to_string(sumMicros / 1.0e6) + "\n";
+    out += std::string(name) + "_count" + suffix + " " + std::to_string(cumulative) + "\n";
+}
+
+std::string render() {
+    std::string out;
+    const char* lastName = "";
+    for (const Metric* metric : registry()) {
+        // Labelled series of one metric share a single HELP/TYPE header
+        if (std::string(metric->getName()) != lastName) {
+            out += "# HELP " + std::string(metric->getName()) + " " + metric->getHelp() + "\n";
+            out += "# TYPE " + std::string(metric->getName()) + " " + metric->getType() + "\n";
+            lastName = metric->getName();
+        }
+        metric->write(out);
+    }
+    return out;
+}
+
+MetricsServer::MetricsServer()
+    : running(false), listenSocket(-1)
+{
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(int port) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "Failed to initialize Winsock" << std::endl;
+        return false;
+    }
+#endif
+
+    auto sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        std::cerr << "Failed to create metrics socket" << std::endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    // Local only; put a reverse proxy in front for remote scraping
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<unsigned short>(port));
+
+    if (bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(sock, 8) != 0) {
+        std::cerr << "Failed to listen for metrics on port " << port << std::endl;
+        CLOSE_SOCKET(sock);
+        return false;
+    }
+
+    listenSocket = static_cast<intptr_t>(sock);
+    running = true;
+    thread = std::thread(&MetricsServer::serve, this);
+    std::cout << "Serving metrics on http://127.0.0.1:" << port << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    thread.join();
+    CLOSE_SOCKET(listenSocket);
+    listenSocket = -1;
+}
+
+void MetricsServer::serve() {
+    while (running) {
+        // Wake up regularly so stop() doesn't wait on a blocking accept
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(listenSocket, &readSet);
+        timeval timeout = {0, 200000};
+        if (select(static_cast<int>(listenSocket) + 1, &readSet, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+
+        auto client = accept(listenSocket, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+
+        // Otherwise a silent client would block this thread, and stop() with it
+        setClientTimeouts(client);
+
+        char request[2048];
+        int received = static_cast<int>(recv(client, request, sizeof(request) - 1, 0));
+        if (received <= 0) {
+            CLOSE_SOCKET(client);
+            continue;
+        }
+        request[received] = '\0';
+
+        std::string response;
+        if (std::string(request).compare(0, 13, "GET /metrics ") == 0 ||
+            std::string(request).compare(0, 13, "GET /metrics?") == 0) {
+            std::string body = render();
+            response = "HTTP/1.1 200 OK\r\n"
+                       "Content-Type: text/plain; version=0.0.4\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                       "Connection: close\r\n\r\n" + body;
+        } else {
+            response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+
+        send(client, response.data(), static_cast<int>(response.size()), 0);
+        CLOSE_SOCKET(client);
+    }
+}
+
+Counter framesRendered("mandelbrot_frames_rendered_total", "Full frames rendered");
+Counter tilesRendered("mandelbrot_tiles_rendered_total", "Tiles rendered by the CPU scheduler");
+Counter iterationsExecuted("mandelbrot_iterations_total", "Escape-time iterations executed on the CPU");
+Counter tileCacheHits("mandelbrot_tile_cache_hits_total", "Tile requests served from the cache or an in-flight render");
+Counter tileCacheMisses("mandelbrot_tile_cache_misses_total", "Tile requests that had to be rendered");
+Counter tileStoreHits("mandelbrot_tile_store_hits_total", "Tiles loaded from the on-disk tile store instead of rendered");
+Gauge queueDepth("mandelbrot_queue_depth", "Tiles waiting in the scheduler queues");
+Gauge tileCacheBytes("mandelbrot_tile_cache_bytes", "Memory held by the tile cache, compressed tiles plus entry overhead");
+Histogram openclFrameLatency("mandelbrot_render_latency_seconds", "Render latency per backend", "backend=\"opencl\"");
+Histogram cpuTileLatency("mandelbrot_render_latency_seconds", "Render latency per backend", "backend=\"cpu\"");
+Gauge startupFirstPixel("mandelbrot_startup_milliseconds", "Time from launch to each startup milestone", "stage=\"first_pixel\"");
+Gauge startupDeviceReady("mandelbrot_startup_milliseconds", "Time from launch to each startup milestone", "stage=\"device_ready\"");
+Gauge startupFirstFrame("mandelbrot_startup_milliseconds", "Time from launch to each startup milestone", "stage=\"first_frame\"");
+
+} // namespace Metrics
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// Operational metrics exposed in Prometheus text format. Updates go to a per-thread
+// shard with a relaxed atomic add, so render threads never contend or take a lock;
+// shards are only summed when /metrics is scraped.
+namespace Metrics {
+    const int SHARD_COUNT = 16;
+
+    // Shard of the calling thread
+    int threadShard();
+
+    class Metric {
+    public:
+        Metric(const char* name, const char* help, const char* type, const char* labels);
+        virtual ~Metric() {}
+
+        const char* getName() const { return name; }
+        const char* getHelp() const { return help; }
+        const char* getType() const { return type; }
+
+        virtual void write(std::string& out) const = 0;
+
+    protected:
+        std::string fullName() const;
+
+        const char* name;
+        const char* help;
+        const char* type;
+        const char* labels;  // e.g. "backend=\"cpu\"", or empty
+    };
+
+    class Counter : public Metric {
+    public:
+        Counter(const char* name, const char* help, const char* labels = "");
+
+        void add(uint64_t amount = 1) {
+            shards[threadShard()].value.fetch_add(amount, std::memory_order_relaxed);
+        }
+        uint64_t value() const;
+        void write(std::string& out) const override;
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> value{0};
+        };
+        Shard shards[SHARD_COUNT];
+    };
+
+    class Gauge : public Metric {
+    public:
+        Gauge(const char* name, const char* help, const char* labels = "");
+
+        void set(int64_t newValue) { current.store(newValue, std::memory_order_relaxed); }
+        void write(std::string& out) const override;
+
+    private:
+        std::atomic<int64_t> current{0};
+    };
+
+    // Latency histogram with fixed buckets from 1 ms to 10 s
+    class Histogram : public Metric {
+    public:
+        static const int BUCKET_COUNT = 13;
+
+        Histogram(const char* name, const char* help, const char* labels = "");
+
+        void observe(double seconds);
+        void write(std::string& out) const override;
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> buckets[BUCKET_COUNT + 1];  // Last bucket is +Inf
+            std::atomic<uint64_t> sumMicros{0};
+        };
+        Shard shards[SHARD_COUNT];
+    };
+
+    // Renders every registered metric
+    std::string render();
+
+    // Minimal HTTP server answering GET /metrics on 127.0.0.1
+    class MetricsServer {
+    public:
+        MetricsServer();
+        ~MetricsServer();
+
+        MetricsServer(const MetricsServer&) = delete;
+        MetricsServer& operator=(const MetricsServer&) = delete;
+
+        bool start(int port);
+        void stop();
+
+    private:
+        void serve();
+
+        std::thread thread;
+        std::atomic<bool> running;
+        intptr_t listenSocket;
+    };
+
+    // Metrics shared by the viewer, scheduler and benchmark
+    extern Counter framesRendered;
+    extern Counter tilesRendered;
+    extern Counter iterationsExecuted;
+    extern Counter tileCacheHits;
+    extern Counter tileCacheMisses;
+    extern Counter tileStoreHits;
+    extern Gauge queueDepth;
+    extern Gauge tileCacheBytes;
+    extern Histogram openclFrameLatency;
+    extern Histogram cpuTileLatency;
+    extern Gauge startupFirstPixel;
+    extern Gauge startupDeviceReady;
+    extern Gauge startupFirstFrame;
+}
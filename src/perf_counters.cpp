@@ -0,0 +1,107 @@
+#include "perf_counters.hpp"
+#include <iostream>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int openCounter(uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfCounters::PerfCounters()
+    : available(true)
+{
+    const uint64_t configs[COUNTER_COUNT] = {
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        fds[i] = openCounter(configs[i]);
+        if (fds[i] < 0) {
+            available = false;
+        }
+    }
+
+    if (!available) {
+        std::cerr << "perf_event counters unavailable (check /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+}
+
+void PerfCounters::start() {
+    if (!available) {
+        return;
+    }
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample sample = {false, 0, 0, 0, 0};
+    if (!available) {
+        return sample;
+    }
+
+    uint64_t values[COUNTER_COUNT] = {0, 0, 0, 0};
+    sample.valid = true;
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) {
+            sample.valid = false;
+        }
+    }
+
+    sample.instructions = values[0];
+    sample.cycles = values[1];
+    sample.cacheMisses = values[2];
+    sample.branchMisses = values[3];
+    return sample;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+    : available(false)
+{
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        fds[i] = -1;
+    }
+    std::cerr << "perf_event counters are only supported on Linux" << std::endl;
+}
+
+PerfCounters::~PerfCounters() {
+}
+
+void PerfCounters::start() {
+}
+
+PerfSample PerfCounters::stop() {
+    return PerfSample{false, 0, 0, 0, 0};
+}
+
+#endif
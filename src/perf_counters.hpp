@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+// Hardware counter totals for one measured interval
+struct PerfSample {
+    bool valid;
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t cacheMisses;
+    uint64_t branchMisses;
+
+    double ipc() const { return cycles > 0 ? static_cast<double>(instructions) / cycles : 0.0; }
+};
+
+// Linux perf_event counters for the calling process. Threads created after construction
+// are included once they exit, so worker pools must be joined before stop().
+// On other platforms, or when perf_event access is denied, isAvailable() is false
+// and stop() returns an invalid sample.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool isAvailable() const { return available; }
+
+    void start();
+    PerfSample stop();
+
+private:
+    static const int COUNTER_COUNT = 4;
+
+    int fds[COUNTER_COUNT];
+    bool available;
+};
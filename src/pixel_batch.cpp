@@ -0,0 +1,103 @@
+#include "pixel_batch.hpp"
+#include <algorithm>
+#include <cstdint>
+
+// Fused multiply-adds would round differently from escapeIterations and change counts
+// near the boundary; the AVX-512 clone below would otherwise use them. GCC's default
+// -O2 cost model won't vectorize a loop that needs a scalar epilogue, so ask for the
+// full one here.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off", "vect-cost-model=dynamic")
+#endif
+
+namespace {
+
+// Iterations between compactions. Short enough that escaped pixels don't ride along
+// for long, long enough that compaction stays a small share of the work.
+const int FIRST_BATCH_STEPS = 8;
+const int MAX_BATCH_STEPS = 64;
+
+// Pixels iterated together for a whole batch; their state stays in L1
+const size_t BLOCK_PIXELS = 256;
+
+// GCC and Clang also build AVX-512 and AVX2 copies of the loop and pick one at load
+// time, so wide vectors are used where available without building for one CPU
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+__attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+void iterateBlock(double* __restrict x1, double* __restrict y1, double* __restrict x2, double* __restrict y2,
+                  const double* __restrict x0, const double* __restrict y0, int32_t* __restrict iter,
+                  size_t lanes, int steps, int maxIterations) {
+    for (int step = 0; step < steps; ++step) {
+        // Branch-free form of escapeIterations' loop: finished lanes keep their values
+        for (size_t i = 0; i < lanes; ++i) {
+            const bool running = (x2[i] + y2[i] <= 4.0) & (iter[i] < maxIterations);
+            const double nextY = 2.0 * x1[i] * y1[i] + y0[i];
+            const double nextX = x2[i] - y2[i] + x0[i];
+            y1[i] = running ? nextY : y1[i];
+            x1[i] = running ? nextX : x1[i];
+            x2[i] = x1[i] * x1[i];
+            y2[i] = y1[i] * y1[i];
+            iter[i] += running;
+        }
+    }
+}
+
+} // namespace
+
+PixelBatch::PixelBatch() : count(0) {}
+
+void PixelBatch::add(double x0, double y0, int index) {
+    re[count] = 0.0;
+    im[count] = 0.0;
+    re2[count] = 0.0;
+    im2[count] = 0.0;
+    cx[count] = x0;
+    cy[count] = y0;
+    iterations[count] = 0;
+    resultIndex[count] = index;
+    ++count;
+}
+
+void PixelBatch::run(int maxIterations, int* results) {
+    // Most pixels of a typical frame escape within a few iterations, so start with short
+    // batches and lengthen them as the survivors prove to be slow
+    int steps = FIRST_BATCH_STEPS;
+    while (count > 0) {
+        iterate(steps, maxIterations);
+        compact(maxIterations, results);
+        steps = std::min(steps * 2, MAX_BATCH_STEPS);
+    }
+}
+
+void PixelBatch::iterate(int steps, int maxIterations) {
+    for (size_t block = 0; block < count; block += BLOCK_PIXELS) {
+        const size_t end = std::min(count, block + BLOCK_PIXELS);
+        iterateBlock(re + block, im + block, re2 + block, im2 + block, cx + block, cy + block,
+                     iterations + block, end - block, steps, maxIterations);
+    }
+}
+
+void PixelBatch::compact(int maxIterations, int* results) {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (re2[i] + im2[i] > 4.0 || iterations[i] >= maxIterations) {
+            results[resultIndex[i]] = iterations[i];
+            continue;
+        }
+        if (kept != i) {
+            re[kept] = re[i];
+            im[kept] = im[i];
+            re2[kept] = re2[i];
+            im2[kept] = im2[i];
+            cx[kept] = cx[i];
+            cy[kept] = cy[i];
+            iterations[kept] = iterations[i];
+            resultIndex[kept] = resultIndex[i];
+        }
+        ++kept;
+    }
+    count = kept;
+}
@@ -0,0 +1,203 @@
+#include "quality_profile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Moving frames aim this far under the budget so a slightly slower frame still fits
+const double BUDGET_HEADROOM = 0.8;
+
+const double SCALE_STEP = 1.0 / 8.0;
+
+std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(start, end - start + 1);
+}
+
+bool parseBool(const std::string& value, bool& result) {
+    if (value == "true" || value == "on" || value == "1") {
+        result = true;
+    } else if (value == "false" || value == "off" || value == "0") {
+        result = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// False if the key is unknown; throws std::exception on a malformed number
+bool setField(QualityProfile& profile, const std::string& key, const std::string& value, bool& valid) {
+    valid = true;
+    if (key == "render_scale") profile.renderScale = std::stod(value);
+    else if (key == "min_render_scale") profile.minRenderScale = std::stod(value);
+    else if (key == "frame_budget_ms") profile.frameBudgetMs = std::stod(value);
+    else if (key == "iteration_multiplier") profile.iterationMultiplier = std::stoi(value);
+    else if (key == "auto_iterations") valid = parseBool(value, profile.autoIterations);
+    else if (key == "supersample") profile.supersample = std::stoi(value);
+    else if (key == "bailout") profile.bailout.radius = std::stod(value);
+    else if (key == "smooth_coloring") valid = parseBool(value, profile.bailout.smoothColoring);
+    else if (key == "lod_preview") valid = parseBool(value, profile.lodPreview);
+    else if (key == "compacted_passes") valid = parseBool(value, profile.compactedPasses);
+    else return false;
+    return true;
+}
+
+bool validate(const QualityProfile& profile, std::string& error) {
+    if (!(profile.renderScale > 0.0 && profile.renderScale <= 1.0) ||
+        !(profile.minRenderScale > 0.0 && profile.minRenderScale <= profile.renderScale)) {
+        error = "profile '" + profile.name + "': need 0 < min_render_scale <= render_scale <= 1";
+        return false;
+    }
+    if (profile.frameBudgetMs < 0.0 || profile.iterationMultiplier < 1 ||
+        profile.supersample < 1 || profile.supersample > 8) {
+        error = "profile '" + profile.name + "': frame_budget_ms must not be negative, "
+                "iteration_multiplier at least 1 and supersample between 1 and 8";
+        return false;
+    }
+    if (profile.bailout.radius < 2.0) {
+        error = "profile '" + profile.name + "': bailout must be at least 2";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace QualityProfiles {
+
+std::vector<QualityProfile> builtIn() {
+    QualityProfile draft;
+    draft.name = "draft";
+    draft.renderScale = 0.5;
+    draft.minRenderScale = 0.125;
+    draft.frameBudgetMs = 1000.0 / 60.0;
+    draft.iterationMultiplier = 1;
+    draft.bailout = {2.0, false};
+
+    QualityProfile interactive;
+    interactive.name = "interactive";
+    interactive.frameBudgetMs = 1000.0 / 30.0;
+    interactive.iterationMultiplier = 4;
+
+    QualityProfile finalQuality;
+    finalQuality.name = "final";
+    finalQuality.iterationMultiplier = 8;
+    finalQuality.supersample = 2;
+    finalQuality.bailout = {256.0, true};
+    finalQuality.lodPreview = false;
+
+    return {draft, interactive, finalQuality};
+}
+
+bool load(const std::string& filename, std::vector<QualityProfile>& profiles, std::string& error) {
+    std::ifstream file(filename);
+    if (!file) {
+        error = "cannot open " + filename;
+        return false;
+    }
+
+    std::vector<QualityProfile> loaded = profiles;
+    QualityProfile* current = nullptr;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        const std::string where = filename + ":" + std::to_string(lineNumber) + ": ";
+
+        if (line.front() == '[' && line.back() == ']') {
+            std::string name = trim(line.substr(1, line.size() - 2));
+            if (name.empty()) {
+                error = where + "empty profile name";
+                return false;
+            }
+            auto found = std::find_if(loaded.begin(), loaded.end(),
+                                      [&](const QualityProfile& profile) { return profile.name == name; });
+            if (found == loaded.end()) {
+                const QualityProfile* base = find(loaded, "interactive");
+                QualityProfile added = base ? *base : QualityProfile();
+                added.name = name;
+                loaded.push_back(added);
+                current = &loaded.back();
+            } else {
+                current = &*found;
+            }
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (!current || equals == std::string::npos) {
+            error = where + (current ? "expected key=value" : "expected [profile] before settings");
+            return false;
+        }
+        std::string key = trim(line.substr(0, equals));
+        std::string value = trim(line.substr(equals + 1));
+        try {
+            bool valid = true;
+            if (!setField(*current, key, value, valid)) {
+                error = where + "unknown key '" + key + "'";
+                return false;
+            }
+            if (!valid) {
+                error = where + "invalid value for '" + key + "'";
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            error = where + "invalid value for '" + key + "'";
+            return false;
+        }
+    }
+
+    for (const QualityProfile& profile : loaded) {
+        if (!validate(profile, error)) {
+            return false;
+        }
+    }
+    profiles = loaded;
+    return true;
+}
+
+const QualityProfile* find(const std::vector<QualityProfile>& profiles, const std::string& name) {
+    for (const QualityProfile& profile : profiles) {
+        if (profile.name == name) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace QualityProfiles
+
+FrameBudgetController::FrameBudgetController()
+    : budgetMs(0.0), minScale(1.0), maxScale(1.0), scale(1.0) {}
+
+void FrameBudgetController::configure(const QualityProfile& profile) {
+    budgetMs = profile.frameBudgetMs;
+    minScale = profile.minRenderScale;
+    maxScale = profile.renderScale;
+    scale = maxScale;
+}
+
+void FrameBudgetController::recordFrame(double milliseconds) {
+    if (budgetMs <= 0.0 || milliseconds <= 0.0) {
+        return;
+    }
+    double ideal = scale * std::sqrt(budgetMs * BUDGET_HEADROOM / milliseconds);
+    if (ideal >= scale + SCALE_STEP) {
+        // Grow one step at a time, shrink straight to a scale that fits
+        scale += SCALE_STEP;
+    } else if (ideal < scale) {
+        scale = std::floor(ideal / SCALE_STEP) * SCALE_STEP;
+    }
+    scale = std::min(std::max(scale, minScale), maxScale);
+}
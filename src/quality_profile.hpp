@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "mandelbrot.hpp"
+
+// A named bundle of render quality settings. The viewer starts on "interactive",
+// P cycles through the profiles, and high-resolution renders always use "final".
+struct QualityProfile {
+    std::string name;
+
+    // Resolution of frames rendered while the view moves, relative to the window.
+    // With a frame budget the scale adapts between minRenderScale and renderScale.
+    double renderScale = 1.0;
+    double minRenderScale = 0.25;
+    double frameBudgetMs = 0.0;  // 0 for no budget
+
+    // Iteration policy: a multiple of the base limit, or the limit the cost probe
+    // suggests for each settled view
+    int iterationMultiplier = 1;
+    bool autoIterations = false;
+
+    int supersample = 1;  // Samples per pixel along each axis for region and export renders
+
+    // Precision of the escape test and colouring
+    BailoutSettings bailout = {2.0, true};
+
+    // Acceleration
+    bool lodPreview = true;       // Show zoom-outs from earlier frames before rendering them
+    bool compactedPasses = true;  // Iterate high-limit frames in compacted OpenCL passes
+};
+
+namespace QualityProfiles {
+    // "draft", "interactive" and "final"
+    std::vector<QualityProfile> builtIn();
+
+    // Reads [name] sections of key=value lines (same keys as the fields, in snake_case)
+    // over the given profiles: a known name is overridden key by key, a new one starts
+    // from "interactive". Returns false with a message on bad input.
+    bool load(const std::string& filename, std::vector<QualityProfile>& profiles, std::string& error);
+
+    // Null if there is no profile of that name
+    const QualityProfile* find(const std::vector<QualityProfile>& profiles, const std::string& name);
+}
+
+// Picks the render scale of moving frames so they stay within a frame-time budget.
+// Render time goes roughly with the pixel count, so the scale follows the square root
+// of budget over measured time. Scales are quantised to eighths so the render target
+// isn't resized on every frame.
+class FrameBudgetController {
+public:
+    FrameBudgetController();
+
+    // Starts over at the profile's full render scale
+    void configure(const QualityProfile& profile);
+
+    double getScale() const { return scale; }
+
+    // Render time of a frame drawn at getScale()
+    void recordFrame(double milliseconds);
+
+private:
+    double budgetMs;
+    double minScale;
+    double maxScale;
+    double scale;
+};
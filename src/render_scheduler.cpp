@@ -0,0 +1,396 @@
+#include "render_scheduler.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include "cpu_topology.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+#include <chrono>
+
+namespace {
+
+// A worker that runs dry takes at most this many tiles from the client queues at once
+const size_t REFILL_BATCH = 4;
+
+// Tiles estimated above this many iterations are split into strips of about this size
+const double STRIP_ITERATIONS = 1.0e6;
+const int MAX_STRIPS = 8;
+
+// Cost probe: SAMPLE_GRID x SAMPLE_GRID points spread over the tile
+const int SAMPLE_GRID = 4;
+
+int64_t nowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void raiseTo(std::atomic<int64_t>& value, int64_t candidate) {
+    int64_t current = value.load(std::memory_order_relaxed);
+    while (current < candidate && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {
+    }
+}
+
+// Estimated iterations for the whole tile
+double estimateTileCost(const TileKey& key) {
+    const int step = TILE_SIZE / SAMPLE_GRID;
+    uint64_t sampled = 0;
+    for (int sy = 0; sy < SAMPLE_GRID; ++sy) {
+        double y0 = static_cast<double>(key.tileY * TILE_SIZE + sy * step + step / 2) * key.pixelSize;
+        for (int sx = 0; sx < SAMPLE_GRID; ++sx) {
+            double x0 = static_cast<double>(key.tileX * TILE_SIZE + sx * step + step / 2) * key.pixelSize;
+            sampled += TileRenderer::escapeIterations(x0, y0, key.maxIterations);
+        }
+    }
+    return static_cast<double>(sampled) / (SAMPLE_GRID * SAMPLE_GRID) * TILE_SIZE * TILE_SIZE;
+}
+
+} // namespace
+
+struct RenderScheduler::TileTask {
+    TileKey key;
+    TileIterations iterations;
+    std::atomic<int> remainingStrips{0};
+    std::atomic<uint64_t> renderNanoseconds{0};
+    std::atomic<bool> done{false};
+};
+
+RenderScheduler::RenderScheduler(TileCache& cache, int workerCount, TileStore* store)
+    : cache(cache), store(store), nextClient(0), stopping(false), outstandingTiles(0), stealableJobs(0),
+      firstSubmitNanoseconds(0), lastFinishNanoseconds(0), renderedTiles(0), deduplicatedTiles(0), stolenJobs(0)
+{
+    if (workerCount <= 0) {
+        // Leave one core for the UI thread
+        workerCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    }
+
+    std::vector<CpuTopology::WorkerPlacement> placements = CpuTopology::placeWorkers(workerCount);
+    int nodeCount = 0;
+    for (int i = 0; i < workerCount; ++i) {
+        workerState.emplace_back(new Worker());
+        workerState[i]->cpu = placements[i].cpu;
+        workerState[i]->node = placements[i].node;
+        nodeCount = std::max(nodeCount, placements[i].node + 1);
+    }
+
+    // Steal from neighbours on the same node before crossing the interconnect;
+    // each worker starts after itself so thieves don't all hit worker 0
+    for (int i = 0; i < workerCount; ++i) {
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int offset = 1; offset < workerCount; ++offset) {
+                int victim = (i + offset) % workerCount;
+                bool sameNode = workerState[victim]->node == workerState[i]->node;
+                if (sameNode == (pass == 0)) {
+                    workerState[i]->victims.push_back(victim);
+                }
+            }
+        }
+    }
+
+    std::cout << "Starting render scheduler with " << workerCount << " workers on "
+              << nodeCount << " NUMA node" << (nodeCount == 1 ? "" : "s") << std::endl;
+    for (int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&RenderScheduler::workerLoop, this, i);
+    }
+}
+
+RenderScheduler::~RenderScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (auto& worker : workerState) {
+        TileJob* job = nullptr;
+        while (worker->jobs.pop(job)) {
+            delete job;
+        }
+    }
+}
+
+int RenderScheduler::addClient() {
+    std::lock_guard<std::mutex> lock(mutex);
+    clientQueues.emplace_back();
+    return static_cast<int>(clientQueues.size()) - 1;
+}
+
+void RenderScheduler::submit(int clientId, const std::vector<TileKey>& tiles) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (clientId < 0 || clientId >= static_cast<int>(clientQueues.size())) {
+            return;
+        }
+        // Tiles for the client's previous view are no longer wanted
+        clientQueues[clientId].assign(tiles.begin(), tiles.end());
+        updateQueueDepth();
+
+        int64_t unset = 0;
+        firstSubmitNanoseconds.compare_exchange_strong(unset, nowNanoseconds());
+    }
+    workAvailable.notify_all();
+}
+
+std::vector<TileKey> RenderScheduler::unscheduled(int clientId, const std::vector<TileKey>& tiles) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (clientId < 0 || clientId >= static_cast<int>(clientQueues.size())) {
+        return tiles;
+    }
+    const std::deque<TileKey>& queue = clientQueues[clientId];
+    std::unordered_set<TileKey, TileKeyHash> queued(queue.begin(), queue.end());
+
+    std::vector<TileKey> missing;
+    for (const TileKey& key : tiles) {
+        if (queued.count(key)) {
+            continue;
+        }
+        auto running = inFlight.find(key);
+        if (running != inFlight.end() && !running->second->done.load(std::memory_order_acquire)) {
+            continue;
+        }
+        missing.push_back(key);
+    }
+    return missing;
+}
+
+size_t RenderScheduler::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t pending = outstandingTiles.load();
+    for (const auto& queue : clientQueues) {
+        pending += queue.size();
+    }
+    return pending;
+}
+
+double RenderScheduler::getUtilization() const {
+    int64_t window = lastFinishNanoseconds.load() - firstSubmitNanoseconds.load();
+    if (window <= 0 || workerState.empty()) {
+        return 0.0;
+    }
+    uint64_t busy = 0;
+    for (const auto& worker : workerState) {
+        busy += worker->busyNanoseconds.load(std::memory_order_relaxed);
+    }
+    return static_cast<double>(busy) / (static_cast<double>(window) * workerState.size());
+}
+
+bool RenderScheduler::hasQueuedTiles() const {
+    for (const auto& queue : clientQueues) {
+        if (!queue.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RenderScheduler::updateQueueDepth() {
+    size_t queued = 0;
+    for (const auto& queue : clientQueues) {
+        queued += queue.size();
+    }
+    Metrics::queueDepth.set(static_cast<int64_t>(queued));
+}
+
+bool RenderScheduler::takeNextTile(std::shared_ptr<TileTask>& task) {
+    const size_t clientCount = clientQueues.size();
+    for (size_t i = 0; i < clientCount; ++i) {
+        size_t client = (nextClient + i) % clientCount;
+        std::deque<TileKey>& queue = clientQueues[client];
+
+        while (!queue.empty()) {
+            TileKey candidate = queue.front();
+            queue.pop_front();
+
+            // Overlapping views request the same tiles; render each only once
+            auto existing = inFlight.find(candidate);
+            if (existing != inFlight.end() && existing->second->done.load(std::memory_order_acquire)) {
+                inFlight.erase(existing);
+                existing = inFlight.end();
+            }
+            if (existing != inFlight.end() || cache.contains(candidate)) {
+                ++deduplicatedTiles;
+                Metrics::tileCacheHits.add();
+                continue;
+            }
+
+            Metrics::tileCacheMisses.add();
+            task = std::make_shared<TileTask>();
+            task->key = candidate;
+            inFlight.emplace(candidate, task);
+            ++outstandingTiles;
+            updateQueueDepth();
+            nextClient = (client + 1) % clientCount;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RenderScheduler::refill(int workerIndex) {
+    std::vector<std::shared_ptr<TileTask>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t queued = 0;
+        for (const auto& queue : clientQueues) {
+            queued += queue.size();
+        }
+        // Take a fair share so the first worker to wake doesn't grab the whole frame
+        size_t batch = std::min(REFILL_BATCH, std::max<size_t>(1, queued / workerState.size()));
+        std::shared_ptr<TileTask> task;
+        while (tasks.size() < batch && takeNextTile(task)) {
+            tasks.push_back(task);
+        }
+
+        if (inFlight.size() > 2 * workerState.size() * REFILL_BATCH + 256) {
+            for (auto it = inFlight.begin(); it != inFlight.end();) {
+                it = it->second->done.load(std::memory_order_acquire) ? inFlight.erase(it) : std::next(it);
+            }
+        }
+    }
+    if (tasks.empty()) {
+        return false;
+    }
+
+    Worker& self = *workerState[workerIndex];
+    int64_t start = nowNanoseconds();
+    size_t pushed = 0;
+
+    // The owner pops newest first, so push in reverse to render in the requested order
+    for (auto it = tasks.rbegin(); it != tasks.rend(); ++it) {
+        std::shared_ptr<TileTask>& task = *it;
+        task->iterations.resize(TILE_SIZE * TILE_SIZE);
+
+        uint64_t loadStart = Trace::isEnabled() ? Trace::now() : 0;
+        if (store && store->load(task->key, task->iterations)) {
+            if (Trace::isEnabled()) {
+                Trace::complete("tile", "tile load", loadStart, Trace::now() - loadStart,
+                    "\"tileX\": " + std::to_string(task->key.tileX) + ", \"tileY\": " + std::to_string(task->key.tileY));
+            }
+            cache.insert(task->key, task->iterations);
+            TileIterations().swap(task->iterations);
+            task->done.store(true, std::memory_order_release);
+            raiseTo(lastFinishNanoseconds, nowNanoseconds());
+            --outstandingTiles;
+            continue;
+        }
+
+        int strips = static_cast<int>(std::clamp(estimateTileCost(task->key) / STRIP_ITERATIONS, 1.0,
+                                                 static_cast<double>(MAX_STRIPS)));
+        int rowsPerStrip = (TILE_SIZE + strips - 1) / strips;
+        strips = (TILE_SIZE + rowsPerStrip - 1) / rowsPerStrip;
+        task->remainingStrips.store(strips, std::memory_order_relaxed);
+        for (int strip = strips - 1; strip >= 0; --strip) {
+            int rowBegin = strip * rowsPerStrip;
+            self.jobs.push(new TileJob{task, rowBegin, std::min(TILE_SIZE, rowBegin + rowsPerStrip)});
+            ++pushed;
+        }
+    }
+    self.busyNanoseconds.fetch_add(nowNanoseconds() - start, std::memory_order_relaxed);
+
+    stealableJobs += static_cast<int64_t>(pushed);
+    if (pushed > 1) {
+        // Idle workers check stealableJobs under the lock, so taking it here means none
+        // of them can miss the wakeup
+        { std::lock_guard<std::mutex> lock(mutex); }
+        workAvailable.notify_all();
+    }
+    return true;
+}
+
+bool RenderScheduler::findJob(int workerIndex, TileJob*& job) {
+    Worker& self = *workerState[workerIndex];
+    if (self.jobs.pop(job)) {
+        --stealableJobs;
+        return true;
+    }
+    for (int victim : self.victims) {
+        if (workerState[victim]->jobs.steal(job)) {
+            --stealableJobs;
+            ++stolenJobs;
+            return true;
+        }
+    }
+    return false;
+}
+
+void RenderScheduler::runJob(TileJob* job) {
+    TileTask& task = *job->task;
+    const TileKey& key = task.key;
+    uint64_t traceStart = Trace::isEnabled() ? Trace::now() : 0;
+    auto renderStart = std::chrono::steady_clock::now();
+
+    TileRenderer::computeRows(key, job->rowBegin, job->rowEnd, task.iterations.data());
+
+    task.renderNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - renderStart).count(), std::memory_order_relaxed);
+
+    uint64_t iterationSum = 0;
+    for (int i = job->rowBegin * TILE_SIZE; i < job->rowEnd * TILE_SIZE; ++i) {
+        iterationSum += task.iterations[i];
+    }
+    Metrics::iterationsExecuted.add(iterationSum);
+
+    if (Trace::isEnabled()) {
+        bool wholeTile = job->rowBegin == 0 && job->rowEnd == TILE_SIZE;
+        Trace::complete("tile", wholeTile ? "tile" : "tile strip", traceStart, Trace::now() - traceStart,
+            "\"tileX\": " + std::to_string(key.tileX) + ", \"tileY\": " + std::to_string(key.tileY) +
+            ", \"rows\": \"" + std::to_string(job->rowBegin) + "-" + std::to_string(job->rowEnd - 1) + "\"" +
+            ", \"maxIterations\": " + std::to_string(key.maxIterations) + ", \"device\": \"cpu\"");
+    }
+
+    // The last strip to finish publishes the tile
+    if (task.remainingStrips.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        finishTile(task);
+    }
+    delete job;
+}
+
+void RenderScheduler::finishTile(TileTask& task) {
+    Metrics::cpuTileLatency.observe(task.renderNanoseconds.load(std::memory_order_relaxed) / 1.0e9);
+    Metrics::tilesRendered.add();
+
+    cache.insert(task.key, task.iterations);
+    if (store) {
+        store->save(task.key, task.iterations);
+    }
+    ++renderedTiles;
+
+    // inFlight keeps the task until it's swept; the pixels aren't needed any more
+    TileIterations().swap(task.iterations);
+    task.done.store(true, std::memory_order_release);
+    raiseTo(lastFinishNanoseconds, nowNanoseconds());
+    --outstandingTiles;
+}
+
+void RenderScheduler::workerLoop(int workerIndex) {
+    Worker& self = *workerState[workerIndex];
+    Trace::setThreadName("Render worker " + std::to_string(workerIndex));
+    if (self.cpu >= 0 && !CpuTopology::pinCurrentThread(self.cpu) && workerIndex == 0) {
+        std::cerr << "Warning: could not pin render workers to CPUs" << std::endl;
+    }
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        TileJob* job = nullptr;
+        if (findJob(workerIndex, job)) {
+            int64_t start = nowNanoseconds();
+            runJob(job);
+            self.busyNanoseconds.fetch_add(nowNanoseconds() - start, std::memory_order_relaxed);
+            continue;
+        }
+        if (refill(workerIndex)) {
+            continue;
+        }
+
+        uint64_t waitStart = Trace::isEnabled() ? Trace::now() : 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [&] {
+                return stopping.load() || hasQueuedTiles() || stealableJobs.load() > 0;
+            });
+        }
+        if (Trace::isEnabled()) {
+            Trace::complete("scheduler", "queue wait", waitStart, Trace::now() - waitStart);
+        }
+    }
+}
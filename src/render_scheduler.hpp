@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include "tile_cache.hpp"
+#include "tile_store.hpp"
+#include "work_stealing_deque.hpp"
+
+// Worker pool that renders tiles for several clients (viewports) into a shared cache.
+// Clients are served round-robin so one busy view cannot starve the others, and a tile
+// that is already cached or being rendered for another client is never computed twice.
+// With a TileStore, workers load tiles from disk before rendering and persist new ones.
+//
+// Each worker owns a work-stealing deque. A worker that runs dry takes a few tiles from
+// the client queues (the only locked step), estimates their cost from a coarse sample
+// and splits expensive ones into row strips, so an interior-heavy tile can't leave the
+// rest of the pool idle at the end of a frame. Idle workers steal from workers on their
+// own NUMA node first. Workers are pinned to CPUs spread evenly across nodes.
+class RenderScheduler {
+public:
+    explicit RenderScheduler(TileCache& cache, int workerCount = 0, TileStore* store = nullptr);
+    ~RenderScheduler();
+
+    RenderScheduler(const RenderScheduler&) = delete;
+    RenderScheduler& operator=(const RenderScheduler&) = delete;
+
+    int addClient();
+
+    // Replaces the client's pending tiles; earlier tiles in the list are rendered first
+    void submit(int clientId, const std::vector<TileKey>& tiles);
+
+    // The tiles that are neither waiting in the client's queue nor being rendered. A tile
+    // a client misses in the cache and finds here was evicted (or skipped as cached) and
+    // has to be submitted again.
+    std::vector<TileKey> unscheduled(int clientId, const std::vector<TileKey>& tiles) const;
+
+    size_t getPendingCount() const;
+    int getWorkerCount() const { return static_cast<int>(workers.size()); }
+    uint64_t getRenderedCount() const { return renderedTiles.load(); }
+    uint64_t getDeduplicatedCount() const { return deduplicatedTiles.load(); }
+    uint64_t getStolenCount() const { return stolenJobs.load(); }
+
+    // Share of worker time spent on tiles between the first submit and the latest
+    // completed tile
+    double getUtilization() const;
+
+private:
+    struct TileTask;
+
+    // A whole tile, or a strip of rows of an expensive one
+    struct TileJob {
+        std::shared_ptr<TileTask> task;
+        int rowBegin;
+        int rowEnd;
+    };
+
+    struct alignas(64) Worker {
+        WorkStealingDeque<TileJob*> jobs;
+        std::vector<int> victims;  // Same-node workers first
+        std::atomic<uint64_t> busyNanoseconds{0};
+        int cpu = -1;
+        int node = 0;
+    };
+
+    void workerLoop(int workerIndex);
+    bool findJob(int workerIndex, TileJob*& job);
+    bool refill(int workerIndex);
+    bool takeNextTile(std::shared_ptr<TileTask>& task);
+    void runJob(TileJob* job);
+    void finishTile(TileTask& task);
+    bool hasQueuedTiles() const;
+    void updateQueueDepth();
+
+    TileCache& cache;
+    TileStore* store;
+    std::vector<std::unique_ptr<Worker>> workerState;
+    std::vector<std::thread> workers;
+
+    mutable std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::vector<std::deque<TileKey>> clientQueues;
+    // Tiles handed to workers; entries whose task is done are dropped lazily
+    std::unordered_map<TileKey, std::shared_ptr<TileTask>, TileKeyHash> inFlight;
+    size_t nextClient;
+    std::atomic<bool> stopping;
+
+    std::atomic<size_t> outstandingTiles;  // Taken from client queues, not yet finished
+    std::atomic<int64_t> stealableJobs;    // Sitting in some worker's deque
+    std::atomic<int64_t> firstSubmitNanoseconds;
+    std::atomic<int64_t> lastFinishNanoseconds;
+
+    std::atomic<uint64_t> renderedTiles;
+    std::atomic<uint64_t> deduplicatedTiles;
+    std::atomic<uint64_t> stolenJobs;
+};
@@ -0,0 +1,343 @@
+#include "session.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+namespace Session {
+
+namespace {
+
+const char SESSION_MAGIC[8] = {'M', 'B', 'S', 'E', 'S', 'S', 'N', '1'};
+
+// Entry tags in the session file, each followed by its payload
+enum Tag : uint8_t {
+    TAG_FRAME = 1,     // double: seconds since the session started
+    TAG_EVENT = 2,     // SDL_Event
+    TAG_NO_EVENT = 3,  // Poll found the queue empty
+    TAG_TICKS = 4,     // Uint32
+    TAG_MOUSE = 5,     // Uint32 buttons, int x, int y
+    TAG_MODS = 6,      // Uint32
+    TAG_VIEW = 7       // double centerX, centerY, zoom, int maxIterations
+};
+
+enum class Mode {
+    Off,
+    Recording,
+    Replaying
+};
+
+Mode mode = Mode::Off;
+std::string sessionFile;
+std::ofstream output;
+std::vector<char> input;
+size_t cursor = 0;
+bool replayRealTime = false;
+bool replayOver = false;  // Ended, diverged or interrupted
+bool quitDelivered = false;
+
+uint64_t frameCount = 0;
+uint64_t viewMismatches = 0;
+uint64_t firstMismatchFrame = 0;
+std::chrono::steady_clock::time_point sessionStart;
+std::chrono::steady_clock::time_point frameStart;
+bool frameOpen = false;
+std::vector<double> frameTimes;  // Milliseconds
+
+const char* tagName(uint8_t tag) {
+    switch (tag) {
+        case TAG_FRAME: return "frame";
+        case TAG_EVENT: return "event";
+        case TAG_NO_EVENT: return "empty poll";
+        case TAG_TICKS: return "ticks";
+        case TAG_MOUSE: return "mouse state";
+        case TAG_MODS: return "modifier state";
+        case TAG_VIEW: return "view";
+        default: return "end of recording";
+    }
+}
+
+template <typename T>
+void write(const T& value) {
+    output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read(T& value) {
+    if (cursor + sizeof(T) > input.size()) {
+        return false;
+    }
+    std::memcpy(&value, input.data() + cursor, sizeof(T));
+    cursor += sizeof(T);
+    return true;
+}
+
+// Consumes the next entry's tag if it matches; otherwise the replay has diverged
+bool expect(Tag tag) {
+    if (mode != Mode::Replaying || replayOver) {
+        return false;
+    }
+    uint8_t next = cursor < input.size() ? static_cast<uint8_t>(input[cursor]) : 0;
+    if (next == tag) {
+        ++cursor;
+        return true;
+    }
+    if (next == 0) {
+        std::cout << "Replay finished after " << frameCount << " frames" << std::endl;
+    } else {
+        std::cerr << "Replay diverged at frame " << frameCount << ": recording has "
+                  << tagName(next) << ", viewer asked for " << tagName(tag) << std::endl;
+    }
+    replayOver = true;
+    return false;
+}
+
+void resetCounters() {
+    frameCount = 0;
+    viewMismatches = 0;
+    firstMismatchFrame = 0;
+    frameOpen = false;
+    replayOver = false;
+    quitDelivered = false;
+    frameTimes.clear();
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+bool startRecording(const std::string& filename, int width, int height) {
+    output.open(filename, std::ios::binary);
+    if (!output) {
+        std::cerr << "Failed to open session file " << filename << std::endl;
+        return false;
+    }
+    output.write(SESSION_MAGIC, sizeof(SESSION_MAGIC));
+    write<int32_t>(width);
+    write<int32_t>(height);
+
+    resetCounters();
+    mode = Mode::Recording;
+    sessionFile = filename;
+    sessionStart = std::chrono::steady_clock::now();
+    std::cout << "Recording session to " << filename << std::endl;
+    return true;
+}
+
+bool startReplay(const std::string& filename, bool realTime, int width, int height) {
+    std::ifstream file(filename, std::ios::binary);
+    input.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    int32_t recordedWidth = 0;
+    int32_t recordedHeight = 0;
+    cursor = sizeof(SESSION_MAGIC);
+    if (input.size() < sizeof(SESSION_MAGIC) ||
+        std::memcmp(input.data(), SESSION_MAGIC, sizeof(SESSION_MAGIC)) != 0 ||
+        !read(recordedWidth) || !read(recordedHeight)) {
+        std::cerr << "Not a session recording: " << filename << std::endl;
+        return false;
+    }
+    if (recordedWidth != width || recordedHeight != height) {
+        std::cerr << "Warning: session was recorded at " << recordedWidth << "x" << recordedHeight
+                  << ", replaying at " << width << "x" << height << std::endl;
+    }
+
+    resetCounters();
+    mode = Mode::Replaying;
+    sessionFile = filename;
+    replayRealTime = realTime;
+    sessionStart = std::chrono::steady_clock::now();
+    std::cout << "Replaying session " << filename << (realTime ? " in real time" : " as fast as possible") << std::endl;
+    return true;
+}
+
+bool isRecording() {
+    return mode == Mode::Recording;
+}
+
+bool isReplaying() {
+    return mode == Mode::Replaying;
+}
+
+void stop() {
+    if (mode == Mode::Off) {
+        return;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sessionStart).count();
+
+    std::cout << (mode == Mode::Recording ? "Recorded " : "Replayed ") << frameCount << " frames of "
+              << sessionFile << " in " << std::fixed << std::setprecision(2) << seconds << " s" << std::endl;
+    if (!frameTimes.empty()) {
+        std::vector<double> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        std::cout << "Frame time ms: p50 " << percentile(sorted, 0.50) << ", p90 " << percentile(sorted, 0.90)
+                  << ", p99 " << percentile(sorted, 0.99) << ", max " << sorted.back() << std::endl;
+    }
+    if (mode == Mode::Replaying && viewMismatches > 0) {
+        std::cerr << viewMismatches << " frames rendered a different view than recorded, first at frame "
+                  << firstMismatchFrame << std::endl;
+    }
+    std::cout.unsetf(std::ios::fixed);
+
+    output.close();
+    input.clear();
+    frameTimes.clear();
+    mode = Mode::Off;
+}
+
+int pollEvent(SDL_Event* event) {
+    if (mode == Mode::Recording) {
+        int result = SDL_PollEvent(event);
+        // Events carrying pointers can't be replayed
+        if (result && (event->type == SDL_DROPFILE || event->type == SDL_DROPTEXT || event->type >= SDL_USEREVENT)) {
+            return result;
+        }
+        if (result) {
+            write(TAG_EVENT);
+            write(*event);
+        } else {
+            write(TAG_NO_EVENT);
+        }
+        return result;
+    }
+    if (mode != Mode::Replaying) {
+        return SDL_PollEvent(event);
+    }
+
+    // Keep the window responsive; closing it ends the replay early
+    SDL_Event real;
+    while (SDL_PollEvent(&real)) {
+        if (real.type == SDL_QUIT && !replayOver) {
+            std::cout << "Replay interrupted at frame " << frameCount << std::endl;
+            replayOver = true;
+        }
+    }
+
+    if (!replayOver && cursor < input.size() && input[cursor] == TAG_NO_EVENT) {
+        ++cursor;
+        return 0;
+    }
+    if (expect(TAG_EVENT) && read(*event)) {
+        return 1;
+    }
+    replayOver = true;
+
+    // Alternate with an empty poll so every polling loop gets to handle the quit and exit
+    quitDelivered = !quitDelivered;
+    if (!quitDelivered) {
+        return 0;
+    }
+    std::memset(event, 0, sizeof(*event));
+    event->type = SDL_QUIT;
+    return 1;
+}
+
+Uint32 ticks() {
+    Uint32 value = 0;
+    if (mode == Mode::Replaying && expect(TAG_TICKS) && read(value)) {
+        return value;
+    }
+    value = SDL_GetTicks();
+    if (mode == Mode::Recording) {
+        write(TAG_TICKS);
+        write(value);
+    }
+    return value;
+}
+
+Uint32 mouseState(int* x, int* y) {
+    Uint32 buttons = 0;
+    int32_t mouseX = 0;
+    int32_t mouseY = 0;
+    if (mode == Mode::Replaying && expect(TAG_MOUSE) && read(buttons) && read(mouseX) && read(mouseY)) {
+        if (x) *x = mouseX;
+        if (y) *y = mouseY;
+        return buttons;
+    }
+
+    int realX = 0;
+    int realY = 0;
+    buttons = SDL_GetMouseState(&realX, &realY);
+    if (mode == Mode::Recording) {
+        write(TAG_MOUSE);
+        write(buttons);
+        write<int32_t>(realX);
+        write<int32_t>(realY);
+    }
+    if (x) *x = realX;
+    if (y) *y = realY;
+    return buttons;
+}
+
+SDL_Keymod modState() {
+    Uint32 mods = 0;
+    if (mode == Mode::Replaying && expect(TAG_MODS) && read(mods)) {
+        return static_cast<SDL_Keymod>(mods);
+    }
+    mods = SDL_GetModState();
+    if (mode == Mode::Recording) {
+        write(TAG_MODS);
+        write(mods);
+    }
+    return static_cast<SDL_Keymod>(mods);
+}
+
+void beginFrame() {
+    if (mode == Mode::Off) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (mode == Mode::Recording) {
+        write(TAG_FRAME);
+        write(std::chrono::duration<double>(now - sessionStart).count());
+    } else {
+        double recordedTime = 0.0;
+        if (expect(TAG_FRAME) && read(recordedTime) && replayRealTime) {
+            std::this_thread::sleep_until(sessionStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(recordedTime)));
+            now = std::chrono::steady_clock::now();
+        }
+    }
+    frameStart = now;
+    frameOpen = true;
+}
+
+void endFrame(double centerX, double centerY, double zoom, int maxIterations) {
+    if (mode == Mode::Off || !frameOpen) {
+        return;
+    }
+    frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+    frameOpen = false;
+    ++frameCount;
+
+    if (mode == Mode::Recording) {
+        write(TAG_VIEW);
+        write(centerX);
+        write(centerY);
+        write(zoom);
+        write<int32_t>(maxIterations);
+        return;
+    }
+
+    double expectedX = 0.0;
+    double expectedY = 0.0;
+    double expectedZoom = 0.0;
+    int32_t expectedMaxIterations = 0;
+    if (expect(TAG_VIEW) && read(expectedX) && read(expectedY) && read(expectedZoom) && read(expectedMaxIterations)) {
+        if (expectedX != centerX || expectedY != centerY || expectedZoom != zoom || expectedMaxIterations != maxIterations) {
+            if (viewMismatches == 0) {
+                firstMismatchFrame = frameCount;
+            }
+            ++viewMismatches;
+        }
+    }
+}
+
+} // namespace Session
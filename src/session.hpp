@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <SDL2/SDL.h>
+
+// Records an interactive session and replays it deterministically as a benchmark.
+// Everything that steers the main loop from outside (polled events, ticks, mouse and
+// modifier state) goes through the wrappers below. While recording, each result is
+// appended to the session file in order; on replay the same results are returned in the
+// same order, so the loop takes the same path and renders the same views, either as
+// fast as possible or paced to the recorded frame times. Frame times are reported as
+// percentiles when the session stops.
+namespace Session {
+    bool startRecording(const std::string& filename, int width, int height);
+    bool startReplay(const std::string& filename, bool realTime, int width, int height);
+    // Closes the recording or finishes the replay, printing the frame time report
+    void stop();
+
+    bool isRecording();
+    bool isReplaying();
+
+    // Drop-in replacements for SDL_PollEvent, SDL_GetTicks, SDL_GetMouseState and SDL_GetModState.
+    // A replay that ends or diverges from the recording keeps returning SDL_QUIT.
+    int pollEvent(SDL_Event* event);
+    Uint32 ticks();
+    Uint32 mouseState(int* x, int* y);
+    SDL_Keymod modState();
+
+    // Bracket one iteration of the main loop; endFrame also checks the view on replay
+    void beginFrame();
+    void endFrame(double centerX, double centerY, double zoom, int maxIterations);
+}
@@ -0,0 +1,141 @@
+#include "texture_uploader.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "trace.hpp"
+
+TextureUploader::TextureUploader(SDL_Renderer* renderer, int w, int h, int tileSize)
+    : renderer(renderer), texture(nullptr), width(w), height(h), tileSize(tileSize),
+      tilesX(0), tilesY(0), dirtyCount(0), lastUploadBytes(0)
+{
+    createTexture();
+}
+
+TextureUploader::~TextureUploader() {
+    if (texture) {
+        SDL_DestroyTexture(texture);
+    }
+}
+
+void TextureUploader::createTexture() {
+    texture = SDL_CreateTexture(
+        renderer,
+        SDL_PIXELFORMAT_RGB24,
+        SDL_TEXTUREACCESS_STREAMING,
+        width,
+        height
+    );
+    if (!texture) {
+        std::cerr << "Failed to create texture: " << SDL_GetError() << std::endl;
+        throw std::runtime_error("Failed to create texture");
+    }
+
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    dirtyTiles.assign(tilesX * tilesY, 0);
+    dirtyCount = 0;
+
+    // A fresh texture has undefined contents
+    markAllDirty();
+}
+
+void TextureUploader::resize(int newWidth, int newHeight) {
+    if (newWidth <= 0 || newHeight <= 0) {
+        return;
+    }
+    if (newWidth == width && newHeight == height) {
+        return;
+    }
+
+    SDL_DestroyTexture(texture);
+    texture = nullptr;
+    width = newWidth;
+    height = newHeight;
+    createTexture();
+}
+
+void TextureUploader::markDirty(const SDL_Rect& rect) {
+    int x0 = std::max(rect.x, 0);
+    int y0 = std::max(rect.y, 0);
+    int x1 = std::min(rect.x + rect.w, width);
+    int y1 = std::min(rect.y + rect.h, height);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    for (int ty = y0 / tileSize; ty <= (y1 - 1) / tileSize; ++ty) {
+        for (int tx = x0 / tileSize; tx <= (x1 - 1) / tileSize; ++tx) {
+            unsigned char& tile = dirtyTiles[ty * tilesX + tx];
+            if (!tile) {
+                tile = 1;
+                ++dirtyCount;
+            }
+        }
+    }
+}
+
+void TextureUploader::markAllDirty() {
+    std::fill(dirtyTiles.begin(), dirtyTiles.end(), 1);
+    dirtyCount = tilesX * tilesY;
+}
+
+void TextureUploader::upload(const unsigned char* pixels, int pitch) {
+    lastUploadBytes = 0;
+    if (dirtyCount == 0) {
+        return;
+    }
+    Trace::ScopedEvent traceEvent("transfer", "texture upload");
+
+    if (dirtyCount == tilesX * tilesY) {
+        // Whole frame changed, a single full update is cheapest
+        SDL_UpdateTexture(texture, nullptr, pixels, pitch);
+        lastUploadBytes = static_cast<size_t>(width) * height * 3;
+    } else {
+        // Coalesce runs of dirty tiles on each tile row into one rectangle
+        for (int ty = 0; ty < tilesY; ++ty) {
+            int tx = 0;
+            while (tx < tilesX) {
+                if (!dirtyTiles[ty * tilesX + tx]) {
+                    ++tx;
+                    continue;
+                }
+                int runStart = tx;
+                while (tx < tilesX && dirtyTiles[ty * tilesX + tx]) {
+                    ++tx;
+                }
+
+                SDL_Rect rect;
+                rect.x = runStart * tileSize;
+                rect.y = ty * tileSize;
+                rect.w = std::min(tx * tileSize, width) - rect.x;
+                rect.h = std::min((ty + 1) * tileSize, height) - rect.y;
+                uploadRect(rect, pixels, pitch);
+            }
+        }
+    }
+
+    std::fill(dirtyTiles.begin(), dirtyTiles.end(), 0);
+    dirtyCount = 0;
+    traceEvent.setArgs("\"bytes\": " + std::to_string(lastUploadBytes));
+}
+
+void TextureUploader::uploadRect(const SDL_Rect& rect, const unsigned char* pixels, int pitch) {
+    const unsigned char* src = pixels + rect.y * pitch + rect.x * 3;
+    const size_t rowBytes = static_cast<size_t>(rect.w) * 3;
+
+    // Locking a sub-region maps only that part of the staging memory
+    void* locked = nullptr;
+    int lockedPitch = 0;
+    if (SDL_LockTexture(texture, &rect, &locked, &lockedPitch) == 0) {
+        unsigned char* dst = static_cast<unsigned char*>(locked);
+        for (int row = 0; row < rect.h; ++row) {
+            std::memcpy(dst + row * lockedPitch, src + row * pitch, rowBytes);
+        }
+        SDL_UnlockTexture(texture);
+    } else {
+        SDL_UpdateTexture(texture, &rect, src, pitch);
+    }
+    lastUploadBytes += rowBytes * rect.h;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <SDL2/SDL.h>
+
+// Streaming texture that only uploads the tiles marked dirty since the last upload.
+// Dirty tiles on the same tile row are coalesced into a single locked sub-region,
+// so a partial re-render only pays for the pixels it actually changed.
+class TextureUploader {
+public:
+    TextureUploader(SDL_Renderer* renderer, int width, int height, int tileSize = 64);
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    void resize(int newWidth, int newHeight);
+
+    void markDirty(const SDL_Rect& rect);
+    void markAllDirty();
+    bool hasDirty() const { return dirtyCount > 0; }
+
+    // Copies the dirty tiles of an RGB24 frame into the texture and clears the dirty set
+    void upload(const unsigned char* pixels, int pitch);
+
+    SDL_Texture* getTexture() const { return texture; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    size_t getLastUploadBytes() const { return lastUploadBytes; }
+
+private:
+    void createTexture();
+    void uploadRect(const SDL_Rect& rect, const unsigned char* pixels, int pitch);
+
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+    int width;
+    int height;
+    int tileSize;
+    int tilesX;
+    int tilesY;
+    int dirtyCount;
+    size_t lastUploadBytes;
+
+    std::vector<unsigned char> dirtyTiles;
+};
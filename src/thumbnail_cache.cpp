@@ -0,0 +1,228 @@
+#include "thumbnail_cache.hpp"
+#include "pixel_batch.hpp"
+#include "tile_renderer.hpp"
+#include "trace.hpp"
+#include "view_state.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char CACHE_MAGIC[4] = {'M', 'T', 'H', 'B'};
+const int MAX_THREADS = 4;
+
+// A preview this small can't show more detail than this, and it keeps deep views from
+// holding up the rest of the queue
+const int MAX_THUMBNAIL_ITERATIONS = 4096;
+
+uint64_t hashBytes(const std::vector<char>& bytes) {
+    // FNV-1a, seeded with the thumbnail size so a size change invalidates the cache
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (ThumbnailCache::THUMBNAIL_WIDTH * 65536 + ThumbnailCache::THUMBNAIL_HEIGHT);
+    for (char byte : bytes) {
+        hash ^= static_cast<unsigned char>(byte);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+int64_t modificationTime(const std::string& file) {
+    std::error_code error;
+    fs::file_time_type time = fs::last_write_time(file, error);
+    return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+} // namespace
+
+ThumbnailCache::ThumbnailCache(const std::string& cacheDirectory, int threadCount)
+    : cacheDirectory(cacheDirectory), generation(0), stopping(false)
+{
+    if (threadCount <= 0) {
+        threadCount = std::min(MAX_THREADS, std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&ThumbnailCache::workerLoop, this, i);
+    }
+}
+
+ThumbnailCache::~ThumbnailCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    available.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThumbnailCache::request(const std::string& viewFile) {
+    int64_t modified = modificationTime(viewFile);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(viewFile);
+        if (found != entries.end() && found->second.modified == modified) {
+            if (found->second.state != State::Pending) {
+                return;
+            }
+            // Still queued (or rendering): move it to the front
+            auto queued = std::find(queue.begin(), queue.end(), viewFile);
+            if (queued == queue.end()) {
+                return;
+            }
+            queue.erase(queued);
+        } else {
+            entries[viewFile] = Entry{State::Pending, modified, {}};
+        }
+        queue.push_front(viewFile);
+    }
+    available.notify_one();
+}
+
+bool ThumbnailCache::get(const std::string& viewFile, std::vector<unsigned char>& rgb) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(viewFile);
+    if (found == entries.end() || found->second.state != State::Ready) {
+        return false;
+    }
+    rgb = found->second.rgb;
+    return true;
+}
+
+void ThumbnailCache::cancelPending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::string& viewFile : queue) {
+        // Requested again next time the browser opens
+        entries.erase(viewFile);
+    }
+    queue.clear();
+}
+
+void ThumbnailCache::workerLoop(int index) {
+    Trace::setThreadName("Thumbnails " + std::to_string(index));
+    // Too big for the stack
+    std::unique_ptr<PixelBatch> batch(new PixelBatch());
+
+    while (true) {
+        std::string viewFile;
+        int64_t modified;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            viewFile = queue.front();
+            queue.pop_front();
+            modified = entries[viewFile].modified;
+        }
+
+        std::vector<unsigned char> rgb;
+        bool ok = produce(viewFile, *batch, rgb);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = entries.find(viewFile);
+        // The file may have changed (and been requested again) in the meantime
+        if (found != entries.end() && found->second.modified == modified) {
+            found->second.state = ok ? State::Ready : State::Failed;
+            found->second.rgb.swap(rgb);
+            ++generation;
+        }
+    }
+}
+
+bool ThumbnailCache::produce(const std::string& viewFile, PixelBatch& batch, std::vector<unsigned char>& rgb) {
+    TRACE_SCOPE("thumbnail", "thumbnail");
+    std::ifstream viewInput(viewFile, std::ios::binary);
+    if (!viewInput) {
+        return false;
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(viewInput)), std::istreambuf_iterator<char>());
+
+    const size_t rgbBytes = static_cast<size_t>(THUMBNAIL_WIDTH) * THUMBNAIL_HEIGHT * 3;
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.thumb", static_cast<unsigned long long>(hashBytes(bytes)));
+    const fs::path cacheFile = fs::path(cacheDirectory) / name;
+
+    std::ifstream cached(cacheFile, std::ios::binary);
+    if (cached) {
+        char magic[4];
+        int32_t size[2];
+        rgb.resize(rgbBytes);
+        cached.read(magic, sizeof(magic));
+        cached.read(reinterpret_cast<char*>(size), sizeof(size));
+        cached.read(reinterpret_cast<char*>(rgb.data()), rgbBytes);
+        if (cached && std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0 &&
+            size[0] == THUMBNAIL_WIDTH && size[1] == THUMBNAIL_HEIGHT) {
+            return true;
+        }
+    }
+
+    if (!renderView(bytes, batch, rgb)) {
+        return false;
+    }
+
+    // Written under a temporary name and renamed, so a concurrent reader never sees half a file
+    std::error_code error;
+    fs::create_directories(cacheDirectory, error);
+    fs::path partial = cacheFile;
+    partial += ".tmp" + std::to_string(reinterpret_cast<uintptr_t>(&batch));
+    std::ofstream output(partial, std::ios::binary);
+    const int32_t size[2] = {THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT};
+    output.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    output.write(reinterpret_cast<const char*>(size), sizeof(size));
+    output.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    output.close();
+    if (output) {
+        fs::rename(partial, cacheFile, error);
+    }
+    if (!output || error) {
+        // Only the disk copy is lost
+        fs::remove(partial, error);
+    }
+    return true;
+}
+
+bool ThumbnailCache::renderView(const std::vector<char>& bytes, PixelBatch& batch, std::vector<unsigned char>& rgb) {
+    ViewState state;
+    std::string error;
+    if (!parseViewState(reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size(), ViewStateLimits(),
+                        state, error)) {
+        return false;
+    }
+    const int maxIterations = std::min(state.highQualityMode ? state.maxIterations * state.highQualityMultiplier
+                                                             : state.maxIterations,
+                                       MAX_THUMBNAIL_ITERATIONS);
+
+    // Same mapping as the viewer: square pixels, THUMBNAIL_HEIGHT of them per 4 / zoom
+    const double pixelSize = 4.0 / state.zoom / THUMBNAIL_HEIGHT;
+    const int pixels = THUMBNAIL_WIDTH * THUMBNAIL_HEIGHT;
+    std::vector<int> iterations(pixels);
+    batch.clear();
+    for (int y = 0; y < THUMBNAIL_HEIGHT; ++y) {
+        const double y0 = state.centerY + (y - THUMBNAIL_HEIGHT / 2.0) * pixelSize;
+        for (int x = 0; x < THUMBNAIL_WIDTH; ++x) {
+            batch.add(state.centerX + (x - THUMBNAIL_WIDTH / 2.0) * pixelSize, y0, y * THUMBNAIL_WIDTH + x);
+            if (batch.activeCount() == PixelBatch::CAPACITY) {
+                if (stopping) {
+                    return false;
+                }
+                batch.run(maxIterations, iterations.data());
+                batch.clear();
+            }
+        }
+    }
+    batch.run(maxIterations, iterations.data());
+    batch.clear();
+
+    rgb.resize(static_cast<size_t>(pixels) * 3);
+    TileRenderer::colorize(iterations.data(), pixels, maxIterations, state.colorMode, state.colorShift, rgb.data());
+    return true;
+}
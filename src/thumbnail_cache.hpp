@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class PixelBatch;
+
+// Small previews of saved view files for the view browser. Requests return at once;
+// a pool of background threads renders each view at THUMBNAIL_WIDTH x THUMBNAIL_HEIGHT
+// on the CPU and keeps the result in memory and in a cache directory, keyed by a hash of
+// the view file's contents, so reopening the browser (or restarting) costs a file read.
+class ThumbnailCache {
+public:
+    static const int THUMBNAIL_WIDTH = 160;
+    static const int THUMBNAIL_HEIGHT = 120;
+
+    explicit ThumbnailCache(const std::string& cacheDirectory, int threadCount = 0);
+    ~ThumbnailCache();
+
+    ThumbnailCache(const ThumbnailCache&) = delete;
+    ThumbnailCache& operator=(const ThumbnailCache&) = delete;
+
+    // Queues the view file unless its current version is ready or queued. Requests are
+    // served most recent first, so the ones on screen should be made last.
+    void request(const std::string& viewFile);
+
+    // Copies the RGB24 thumbnail if it is ready; false while pending or if the file
+    // couldn't be read as a view
+    bool get(const std::string& viewFile, std::vector<unsigned char>& rgb) const;
+
+    // Drops requests that haven't started, e.g. when the browser closes
+    void cancelPending();
+
+    // Changes whenever a thumbnail finishes, so callers can tell when to redraw
+    uint64_t getGeneration() const { return generation.load(); }
+
+private:
+    enum class State { Pending, Ready, Failed };
+
+    struct Entry {
+        State state;
+        int64_t modified;  // File time the entry was made for
+        std::vector<unsigned char> rgb;
+    };
+
+    void workerLoop(int index);
+    // Reads the view file, then loads its thumbnail from disk or renders and stores it
+    bool produce(const std::string& viewFile, PixelBatch& batch, std::vector<unsigned char>& rgb);
+    bool renderView(const std::vector<char>& bytes, PixelBatch& batch, std::vector<unsigned char>& rgb);
+
+    std::string cacheDirectory;
+    std::vector<std::thread> threads;
+    mutable std::mutex mutex;
+    std::condition_variable available;
+    std::deque<std::string> queue;
+    std::unordered_map<std::string, Entry> entries;
+    std::atomic<uint64_t> generation;
+    std::atomic<bool> stopping;
+};
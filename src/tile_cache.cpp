@@ -0,0 +1,74 @@
+#include "tile_cache.hpp"
+#include "metrics.hpp"
+#include "tile_codec.hpp"
+
+// Map node, LRU node and vector header per tile; uniform tiles compress to a few
+// bytes, so without this the entry count would be nearly unbounded
+const size_t ENTRY_OVERHEAD_BYTES = 128;
+
+TileCache::TileCache(size_t capacityBytes)
+    : capacity(capacityBytes > 0 ? capacityBytes : 1), bytes(0)
+{
+}
+
+std::shared_ptr<const TileIterations> TileCache::find(const TileKey& key) {
+    std::shared_ptr<const CompressedTile> data;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            return nullptr;
+        }
+        lru.splice(lru.begin(), lru, it->second.lruPosition);
+        data = it->second.data;
+    }
+
+    // Decode outside the lock so render threads inserting tiles aren't held up
+    auto tile = std::make_shared<TileIterations>(TILE_SIZE * TILE_SIZE);
+    if (!TileCodec::decode(data->data(), data->size(), TILE_SIZE, TILE_SIZE, tile->data())) {
+        return nullptr;
+    }
+    return tile;
+}
+
+bool TileCache::contains(const TileKey& key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.count(key) > 0;
+}
+
+void TileCache::insert(const TileKey& key, const TileIterations& tile) {
+    auto data = std::make_shared<CompressedTile>();
+    TileCodec::encode(tile.data(), TILE_SIZE, TILE_SIZE, *data);
+    data->shrink_to_fit();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        bytes -= it->second.data->size();
+        bytes += data->size();
+        it->second.data = std::move(data);
+        lru.splice(lru.begin(), lru, it->second.lruPosition);
+    } else {
+        bytes += data->size() + ENTRY_OVERHEAD_BYTES;
+        lru.push_front(key);
+        entries[key] = Entry{std::move(data), lru.begin()};
+    }
+
+    while (bytes > capacity && entries.size() > 1) {
+        auto last = entries.find(lru.back());
+        bytes -= last->second.data->size() + ENTRY_OVERHEAD_BYTES;
+        entries.erase(last);
+        lru.pop_back();
+    }
+    Metrics::tileCacheBytes.set(static_cast<int64_t>(bytes));
+}
+
+size_t TileCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t TileCache::getBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "tile_renderer.hpp"
+
+// Thread-safe LRU cache of rendered iteration tiles, shared by all viewports.
+// Iterations are cached rather than colours so palette changes never recompute.
+// Tiles are held compressed (see TileCodec) and the capacity counts compressed bytes
+// plus a fixed per-entry overhead, so interior-heavy and smooth views fit many more
+// tiles than raw storage would.
+class TileCache {
+public:
+    explicit TileCache(size_t capacityBytes);
+
+    // Decompressed copy of the tile, or null
+    std::shared_ptr<const TileIterations> find(const TileKey& key);
+    bool contains(const TileKey& key) const;
+    void insert(const TileKey& key, const TileIterations& tile);
+
+    size_t size() const;
+    size_t getBytes() const;
+    size_t getCapacity() const { return capacity; }
+
+private:
+    using CompressedTile = std::vector<uint8_t>;
+
+    struct Entry {
+        std::shared_ptr<const CompressedTile> data;
+        std::list<TileKey>::iterator lruPosition;
+    };
+
+    size_t capacity;
+    size_t bytes;
+    mutable std::mutex mutex;
+    std::list<TileKey> lru;  // Most recently used at the front
+    std::unordered_map<TileKey, Entry, TileKeyHash> entries;
+};
@@ -0,0 +1,87 @@
+#include "tile_codec.hpp"
+
+namespace TileCodec {
+
+// Token layout: low bit set means a run of (token >> 1) + 1 exact predictions,
+// clear means one value with zigzag residual token >> 1.
+static void writeVarint(uint64_t value, std::vector<uint8_t>& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool readVarint(const uint8_t*& data, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (data == end) {
+            return false;
+        }
+        uint8_t byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline int predict(const int* values, int width, size_t index) {
+    if (index % width != 0) {
+        return values[index - 1];
+    }
+    return index >= static_cast<size_t>(width) ? values[index - width] : 0;
+}
+
+void encode(const int* values, int width, int height, std::vector<uint8_t>& out) {
+    const size_t count = static_cast<size_t>(width) * height;
+    uint64_t run = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int64_t residual = static_cast<int64_t>(values[i]) - predict(values, width, i);
+        if (residual == 0) {
+            ++run;
+            continue;
+        }
+        if (run > 0) {
+            writeVarint(((run - 1) << 1) | 1, out);
+            run = 0;
+        }
+        uint64_t zigzag = residual < 0 ? (static_cast<uint64_t>(-residual) << 1) - 1
+                                       : static_cast<uint64_t>(residual) << 1;
+        writeVarint(zigzag << 1, out);
+    }
+    if (run > 0) {
+        writeVarint(((run - 1) << 1) | 1, out);
+    }
+}
+
+bool decode(const uint8_t* data, size_t size, int width, int height, int* values) {
+    const uint8_t* end = data + size;
+    const size_t count = static_cast<size_t>(width) * height;
+    size_t i = 0;
+    while (i < count) {
+        uint64_t token;
+        if (!readVarint(data, end, token)) {
+            return false;
+        }
+        if (token & 1) {
+            uint64_t run = (token >> 1) + 1;
+            if (run > count - i) {
+                return false;
+            }
+            for (uint64_t r = 0; r < run; ++r, ++i) {
+                values[i] = predict(values, width, i);
+            }
+        } else {
+            uint64_t zigzag = token >> 1;
+            int64_t residual = (zigzag & 1) ? -static_cast<int64_t>((zigzag + 1) >> 1)
+                                            : static_cast<int64_t>(zigzag >> 1);
+            values[i] = static_cast<int>(predict(values, width, i) + residual);
+            ++i;
+        }
+    }
+    return data == end;
+}
+
+} // namespace TileCodec
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lossless compression for grids of iteration counts. Each value is predicted from its
+// left neighbour (the one above at the start of a row); runs of exact predictions, such
+// as interior regions at maxIterations, collapse into one token, and other residuals are
+// zigzag varints, so smooth gradients cost about a byte per pixel.
+namespace TileCodec {
+    // Appends the encoded width x height grid to out
+    void encode(const int* values, int width, int height, std::vector<uint8_t>& out);
+
+    // Returns false if the data is corrupt or doesn't hold exactly width x height values
+    bool decode(const uint8_t* data, size_t size, int width, int height, int* values);
+}
@@ -0,0 +1,109 @@
+#include "tile_renderer.hpp"
+#include "color_palettes.hpp"
+#include "pixel_batch.hpp"
+#include <functional>
+#include <algorithm>
+#include <memory>
+
+size_t TileKeyHash::operator()(const TileKey& key) const {
+    size_t h = std::hash<double>()(key.pixelSize);
+    h ^= std::hash<int64_t>()(key.tileX) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= std::hash<int64_t>()(key.tileY) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= std::hash<int>()(key.maxIterations) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+namespace TileRenderer {
+
+static unsigned char toByte(float channel) {
+    // Palettes can go slightly out of range for the lowest iteration counts
+    return static_cast<unsigned char>(std::min(std::max(channel, 0.0f), 1.0f) * 255.0f);
+}
+
+int64_t tileIndex(int64_t pixel) {
+    return pixel >= 0 ? pixel / TILE_SIZE : -((-pixel + TILE_SIZE - 1) / TILE_SIZE);
+}
+
+int escapeIterations(double x0, double y0, int maxIterations) {
+    double x1 = 0.0;
+    double y1 = 0.0;
+    double x2 = 0.0;
+    double y2 = 0.0;
+    int iter = 0;
+
+    while (x2 + y2 <= 4.0 && iter < maxIterations) {
+        y1 = 2.0 * x1 * y1 + y0;
+        x1 = x2 - y2 + x0;
+        x2 = x1 * x1;
+        y2 = y1 * y1;
+        iter++;
+    }
+    return iter;
+}
+
+void computeIterations(const TileKey& key, int* iterations) {
+    computeRows(key, 0, TILE_SIZE, iterations);
+}
+
+void computeRows(const TileKey& key, int rowBegin, int rowEnd, int* iterations) {
+    const int64_t originX = key.tileX * TILE_SIZE;
+    const int64_t originY = key.tileY * TILE_SIZE;
+
+    // Too big for the stack; one per render thread
+    thread_local std::unique_ptr<PixelBatch> batch(new PixelBatch());
+    batch->clear();
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        double y0 = static_cast<double>(originY + y) * key.pixelSize;
+        for (int x = 0; x < TILE_SIZE; ++x) {
+            double x0 = static_cast<double>(originX + x) * key.pixelSize;
+            batch->add(x0, y0, y * TILE_SIZE + x);
+        }
+    }
+    batch->run(key.maxIterations, iterations);
+}
+
+void colorize(const int* iterations, size_t count, int maxIterations,
+              int colorMode, double colorShift, unsigned char* rgb) {
+    const float shift = static_cast<float>(colorShift);
+    for (size_t i = 0; i < count; ++i) {
+        int iter = iterations[i];
+        Color color = {0.0f, 0.0f, 0.0f};
+        if (iter < maxIterations) {
+            float normIter = static_cast<float>(iter) / maxIterations;
+            normIter = ColorPalettes::applyLogSmooth(normIter);
+            switch (colorMode) {
+                case 0: color = ColorPalettes::rainbowPalette(normIter, shift); break;
+                case 1: color = ColorPalettes::firePalette(normIter, shift); break;
+                case 2: color = ColorPalettes::electricBlue(normIter, shift); break;
+                case 3: color = ColorPalettes::twilightPalette(normIter, shift); break;
+                case 4: color = ColorPalettes::neonPalette(normIter, shift); break;
+                case 5: color = ColorPalettes::vintageSepia(normIter, shift); break;
+                default: break;
+            }
+        }
+        rgb[i * 3] = toByte(color.r);
+        rgb[i * 3 + 1] = toByte(color.g);
+        rgb[i * 3 + 2] = toByte(color.b);
+    }
+}
+
+bool copyTileToImage(const unsigned char* tileRgb, int64_t tileLeft, int64_t tileTop,
+                     unsigned char* image, int width, int height,
+                     int& x0, int& y0, int& x1, int& y1) {
+    x0 = static_cast<int>(std::max<int64_t>(tileLeft, 0));
+    y0 = static_cast<int>(std::max<int64_t>(tileTop, 0));
+    x1 = static_cast<int>(std::min<int64_t>(tileLeft + TILE_SIZE, width));
+    y1 = static_cast<int>(std::min<int64_t>(tileTop + TILE_SIZE, height));
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+
+    for (int y = y0; y < y1; ++y) {
+        const unsigned char* src = tileRgb + ((y - tileTop) * TILE_SIZE + (x0 - tileLeft)) * 3;
+        unsigned char* dst = image + (static_cast<size_t>(y) * width + x0) * 3;
+        std::copy(src, src + (x1 - x0) * 3, dst);
+    }
+    return true;
+}
+
+} // namespace TileRenderer
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Tiles live on a global pixel grid: pixel (px, py) maps to the complex point
+// (px * pixelSize, py * pixelSize), so any two views with the same pixel size
+// share tiles regardless of their centers.
+const int TILE_SIZE = 64;
+
+struct TileKey {
+    double pixelSize;
+    int64_t tileX;
+    int64_t tileY;
+    int maxIterations;
+
+    bool operator==(const TileKey& other) const {
+        return pixelSize == other.pixelSize && tileX == other.tileX &&
+               tileY == other.tileY && maxIterations == other.maxIterations;
+    }
+};
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& key) const;
+};
+
+using TileIterations = std::vector<int>;
+
+namespace TileRenderer {
+    // Floor division that also works for negative pixel coordinates
+    int64_t tileIndex(int64_t pixel);
+
+    // Escape-time iteration count of a single point
+    int escapeIterations(double x0, double y0, int maxIterations);
+
+    // Escape-time iteration counts for the TILE_SIZE x TILE_SIZE pixels of a tile
+    void computeIterations(const TileKey& key, int* iterations);
+
+    // Same for rows rowBegin..rowEnd-1 only; `iterations` still points at the whole tile
+    void computeRows(const TileKey& key, int rowBegin, int rowEnd, int* iterations);
+
+    // Map iteration counts to RGB24 with the same palettes and smoothing as the OpenCL kernel
+    void colorize(const int* iterations, size_t count, int maxIterations,
+                  int colorMode, double colorShift, unsigned char* rgb);
+
+    // Copies the part of an RGB24 tile that overlaps a width x height image, where the
+    // tile's top-left pixel sits at (tileLeft, tileTop) in image coordinates.
+    // Returns false if they don't overlap; otherwise x0..x1, y0..y1 is the copied area.
+    bool copyTileToImage(const unsigned char* tileRgb, int64_t tileLeft, int64_t tileTop,
+                         unsigned char* image, int width, int height,
+                         int& x0, int& y0, int& x1, int& y1);
+}
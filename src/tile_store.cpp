@@ -0,0 +1,377 @@
+#include "tile_store.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "metrics.hpp"
+#include "tile_codec.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+const char STORE_MAGIC[8] = {'M', 'B', 'T', 'S', 'T', 'O', 'R', 'E'};
+const uint32_t STORE_VERSION = 1;
+const size_t MIN_STORE_BYTES = 4 * 1024 * 1024;
+
+const uint32_t SLOT_EMPTY = 0;
+const uint32_t SLOT_USED = 1;
+const uint32_t SLOT_DELETED = 2;
+
+// Ring record length meaning "continue at the start of the ring"
+const uint32_t WRAP_MARKER = 0xFFFFFFFF;
+
+struct TileStore::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t clean;       // Cleared while open, so a crash is detected on the next open
+    uint64_t slotCount;   // Power of two
+    uint64_t dataSize;
+    uint64_t head;        // Next write offset in the ring
+    uint64_t tail;        // Oldest record
+    uint64_t used;        // Bytes of records between tail and head
+    uint64_t liveSlots;
+    uint64_t deletedSlots;
+};
+
+struct TileStore::IndexSlot {
+    double pixelSize;
+    int64_t tileX;
+    int64_t tileY;
+    int32_t maxIterations;
+    uint32_t state;
+    uint64_t offset;      // Record in the ring
+    uint32_t length;      // Compressed payload bytes
+    uint32_t checksum;
+};
+
+// Precedes each payload in the ring so eviction knows which index slot to drop
+struct TileStore::RecordHeader {
+    double pixelSize;
+    int64_t tileX;
+    int64_t tileY;
+    int32_t maxIterations;
+    uint32_t length;
+};
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// FNV-1a, enough to reject torn or stale records
+static uint32_t checksum(const unsigned char* bytes, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool sameKey(const TileKey& key, double pixelSize, int64_t tileX, int64_t tileY, int32_t maxIterations) {
+    return key.pixelSize == pixelSize && key.tileX == tileX && key.tileY == tileY &&
+           key.maxIterations == maxIterations;
+}
+
+TileStore::TileStore(const std::string& filename, size_t capacityBytes)
+    : header(nullptr), slots(nullptr), data(nullptr), mapping(nullptr), mappedBytes(0)
+{
+    const size_t fileBytes = std::max(capacityBytes, MIN_STORE_BYTES);
+
+#ifdef _WIN32
+    // No sharing: a second instance fails to open instead of corrupting the store
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                             OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    mappingHandle = nullptr;
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open tile store " << filename << std::endl;
+        throw std::runtime_error("Failed to open tile store");
+    }
+#else
+    fileDescriptor = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fileDescriptor < 0) {
+        std::cerr << "Failed to open tile store " << filename << std::endl;
+        throw std::runtime_error("Failed to open tile store");
+    }
+    if (flock(fileDescriptor, LOCK_EX | LOCK_NB) != 0) {
+        close(fileDescriptor);
+        std::cerr << "Tile store " << filename << " is in use by another process" << std::endl;
+        throw std::runtime_error("Tile store is locked");
+    }
+#endif
+
+    map(fileBytes);
+
+    // About 1 KB per compressed tile on average; the index is kept under 3/4 full
+    uint64_t slotCount = 1024;
+    while (slotCount < fileBytes / 1024) {
+        slotCount *= 2;
+    }
+    const uint64_t dataOffset = alignUp(sizeof(Header) + slotCount * sizeof(IndexSlot), 64);
+
+    header = static_cast<Header*>(mapping);
+    slots = reinterpret_cast<IndexSlot*>(static_cast<unsigned char*>(mapping) + sizeof(Header));
+    data = static_cast<unsigned char*>(mapping) + dataOffset;
+
+    bool valid = std::memcmp(header->magic, STORE_MAGIC, sizeof(STORE_MAGIC)) == 0 &&
+                 header->version == STORE_VERSION && header->clean == 1 &&
+                 header->slotCount == slotCount && header->dataSize == fileBytes - dataOffset;
+    if (!valid) {
+        header->slotCount = slotCount;
+        header->dataSize = fileBytes - dataOffset;
+        reset();
+    }
+    header->clean = 0;
+
+    std::cout << "Tile store " << filename << ": " << header->liveSlots << " tiles, "
+              << fileBytes / (1024 * 1024) << " MB" << std::endl;
+}
+
+TileStore::~TileStore() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (header) {
+        header->clean = 1;
+    }
+    unmap();
+#ifdef _WIN32
+    CloseHandle(fileHandle);
+#else
+    close(fileDescriptor);
+#endif
+}
+
+void TileStore::map(size_t fileBytes) {
+#ifdef _WIN32
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READWRITE,
+                                       static_cast<DWORD>(static_cast<uint64_t>(fileBytes) >> 32),
+                                       static_cast<DWORD>(fileBytes & 0xFFFFFFFF), nullptr);
+    mapping = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, fileBytes) : nullptr;
+    if (!mapping) {
+        if (mappingHandle) {
+            CloseHandle(mappingHandle);
+        }
+        CloseHandle(fileHandle);
+        throw std::runtime_error("Failed to map tile store");
+    }
+#else
+    // The file is sparse, so disk space is only used as tiles are written
+    if (ftruncate(fileDescriptor, static_cast<off_t>(fileBytes)) != 0) {
+        close(fileDescriptor);
+        throw std::runtime_error("Failed to size tile store");
+    }
+    mapping = mmap(nullptr, fileBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    if (mapping == MAP_FAILED) {
+        close(fileDescriptor);
+        throw std::runtime_error("Failed to map tile store");
+    }
+#endif
+    mappedBytes = fileBytes;
+}
+
+void TileStore::unmap() {
+    if (!mapping) {
+        return;
+    }
+#ifdef _WIN32
+    FlushViewOfFile(mapping, mappedBytes);
+    UnmapViewOfFile(mapping);
+    CloseHandle(mappingHandle);
+#else
+    msync(mapping, mappedBytes, MS_SYNC);
+    munmap(mapping, mappedBytes);
+#endif
+    mapping = nullptr;
+    header = nullptr;
+}
+
+void TileStore::reset() {
+    std::memcpy(header->magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    header->version = STORE_VERSION;
+    header->head = 0;
+    header->tail = 0;
+    header->used = 0;
+    header->liveSlots = 0;
+    header->deletedSlots = 0;
+    std::memset(slots, 0, header->slotCount * sizeof(IndexSlot));
+}
+
+TileStore::IndexSlot* TileStore::findSlot(const TileKey& key, bool forInsert) {
+    const uint64_t mask = header->slotCount - 1;
+    IndexSlot* firstDeleted = nullptr;
+    uint64_t index = TileKeyHash()(key) & mask;
+    for (uint64_t probe = 0; probe < header->slotCount; ++probe, index = (index + 1) & mask) {
+        IndexSlot& slot = slots[index];
+        if (slot.state == SLOT_EMPTY) {
+            if (!forInsert) {
+                return nullptr;
+            }
+            return firstDeleted ? firstDeleted : &slot;
+        }
+        if (slot.state == SLOT_DELETED) {
+            if (!firstDeleted) {
+                firstDeleted = &slot;
+            }
+        } else if (sameKey(key, slot.pixelSize, slot.tileX, slot.tileY, slot.maxIterations)) {
+            return &slot;
+        }
+    }
+    return forInsert ? firstDeleted : nullptr;
+}
+
+void TileStore::rebuildIndex() {
+    std::vector<IndexSlot> live;
+    live.reserve(header->liveSlots);
+    for (uint64_t i = 0; i < header->slotCount; ++i) {
+        if (slots[i].state == SLOT_USED) {
+            live.push_back(slots[i]);
+        }
+    }
+
+    std::memset(slots, 0, header->slotCount * sizeof(IndexSlot));
+    for (const IndexSlot& slot : live) {
+        TileKey key{slot.pixelSize, slot.tileX, slot.tileY, slot.maxIterations};
+        *findSlot(key, true) = slot;
+    }
+    header->liveSlots = live.size();
+    header->deletedSlots = 0;
+}
+
+void TileStore::evictOldest() {
+    RecordHeader* record = reinterpret_cast<RecordHeader*>(data + header->tail);
+    if (record->length == WRAP_MARKER) {
+        header->tail = 0;
+        return;
+    }
+
+    const uint64_t recordBytes = alignUp(sizeof(RecordHeader) + record->length, 8);
+    if (recordBytes > header->used) {
+        // Ring bookkeeping no longer adds up; start over rather than trust it
+        std::cerr << "Tile store is inconsistent, clearing it" << std::endl;
+        reset();
+        return;
+    }
+
+    TileKey key{record->pixelSize, record->tileX, record->tileY, record->maxIterations};
+    IndexSlot* slot = findSlot(key, false);
+    // A newer copy of the tile may live elsewhere in the ring
+    if (slot && slot->offset == header->tail) {
+        slot->state = SLOT_DELETED;
+        --header->liveSlots;
+        ++header->deletedSlots;
+    }
+
+    header->tail += recordBytes;
+    header->used -= recordBytes;
+    if (header->tail + sizeof(RecordHeader) > header->dataSize) {
+        header->tail = 0;
+    }
+}
+
+bool TileStore::ensureSpace(uint64_t recordBytes) {
+    if (recordBytes > header->dataSize) {
+        return false;
+    }
+
+    if (header->head + recordBytes > header->dataSize) {
+        // Not enough room before the end of the ring: drop what lies there and wrap
+        while (header->used > 0 && header->tail >= header->head) {
+            evictOldest();
+        }
+        if (header->head + sizeof(RecordHeader) <= header->dataSize) {
+            reinterpret_cast<RecordHeader*>(data + header->head)->length = WRAP_MARKER;
+        }
+        header->head = 0;
+    }
+
+    while (header->used > 0 && header->tail >= header->head &&
+           header->tail < header->head + recordBytes) {
+        evictOldest();
+    }
+    if (header->used == 0) {
+        header->head = 0;
+        header->tail = 0;
+    }
+    return true;
+}
+
+bool TileStore::load(const TileKey& key, TileIterations& tile) {
+    std::vector<unsigned char> payload;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        IndexSlot* slot = findSlot(key, false);
+        if (!slot) {
+            return false;
+        }
+        const unsigned char* bytes = data + slot->offset + sizeof(RecordHeader);
+        if (checksum(bytes, slot->length) != slot->checksum) {
+            return false;
+        }
+        payload.assign(bytes, bytes + slot->length);
+    }
+
+    tile.resize(TILE_SIZE * TILE_SIZE);
+    if (!TileCodec::decode(payload.data(), payload.size(), TILE_SIZE, TILE_SIZE, tile.data())) {
+        return false;
+    }
+    Metrics::tileStoreHits.add();
+    return true;
+}
+
+void TileStore::save(const TileKey& key, const TileIterations& tile) {
+    std::vector<uint8_t> payload;
+    TileCodec::encode(tile.data(), TILE_SIZE, TILE_SIZE, payload);
+    const uint64_t recordBytes = alignUp(sizeof(RecordHeader) + payload.size(), 8);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ensureSpace(recordBytes)) {
+        return;
+    }
+
+    const uint64_t offset = header->head;
+    RecordHeader* record = reinterpret_cast<RecordHeader*>(data + offset);
+    record->pixelSize = key.pixelSize;
+    record->tileX = key.tileX;
+    record->tileY = key.tileY;
+    record->maxIterations = key.maxIterations;
+    record->length = static_cast<uint32_t>(payload.size());
+    std::memcpy(data + offset + sizeof(RecordHeader), payload.data(), payload.size());
+
+    IndexSlot* slot = findSlot(key, true);
+    if (!slot) {
+        rebuildIndex();
+        slot = findSlot(key, true);
+    }
+    if (slot->state == SLOT_DELETED) {
+        --header->deletedSlots;
+    }
+    if (slot->state != SLOT_USED) {
+        ++header->liveSlots;
+    }
+    *slot = IndexSlot{key.pixelSize, key.tileX, key.tileY, key.maxIterations, SLOT_USED,
+                      offset, record->length, checksum(payload.data(), payload.size())};
+
+    header->head += recordBytes;
+    header->used += recordBytes;
+    if (header->head + sizeof(RecordHeader) > header->dataSize) {
+        header->head = 0;
+    }
+
+    // Keep probe sequences short: drop tombstones, and old tiles if the index itself is full
+    if (header->liveSlots + header->deletedSlots > header->slotCount * 3 / 4) {
+        while (header->liveSlots > header->slotCount / 2) {
+            evictOldest();
+        }
+        rebuildIndex();
+    }
+}
+
+size_t TileStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return header ? header->liveSlots : 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "tile_renderer.hpp"
+
+// Persistent tile pyramid: every rendered tile, at every pixel size, in one
+// memory-mapped file that is reopened at startup so revisited locations come back
+// without rendering. The file holds a header, an open-addressing index of tile keys
+// and a ring of TileCodec-compressed tiles; when the ring is full the oldest tiles are
+// overwritten, so the file never grows past its capacity.
+// Safe to use from any number of render threads; one process owns the file at a time.
+class TileStore {
+public:
+    // Throws std::runtime_error if the file can't be created, mapped or locked
+    TileStore(const std::string& filename, size_t capacityBytes);
+    ~TileStore();
+
+    TileStore(const TileStore&) = delete;
+    TileStore& operator=(const TileStore&) = delete;
+
+    // False if the tile isn't stored or its data fails the checksum
+    bool load(const TileKey& key, TileIterations& tile);
+    void save(const TileKey& key, const TileIterations& tile);
+
+    size_t size() const;
+
+private:
+    struct Header;
+    struct IndexSlot;
+    struct RecordHeader;
+
+    void map(size_t fileBytes);
+    void unmap();
+    void reset();
+
+    IndexSlot* findSlot(const TileKey& key, bool forInsert);
+    void rebuildIndex();
+    bool ensureSpace(uint64_t recordBytes);
+    void evictOldest();
+
+    Header* header;
+    IndexSlot* slots;
+    unsigned char* data;
+
+    void* mapping;
+    size_t mappedBytes;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+
+    mutable std::mutex mutex;
+};
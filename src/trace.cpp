@@ -0,0 +1,153 @@
+#include "trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Trace {
+
+namespace {
+
+struct Event {
+    std::string name;
+    const char* category;
+    uint64_t start;
+    uint64_t duration;
+    int track;
+    std::string args;
+};
+
+std::atomic<bool> enabled(false);
+std::mutex mutex;
+std::vector<Event> events;
+std::map<std::thread::id, int> threadTracks;
+std::map<int, std::string> trackNames;
+const auto clockOrigin = std::chrono::steady_clock::now();
+
+// Small stable ids read better in trace viewers than native thread ids
+int currentTrack() {
+    std::thread::id id = std::this_thread::get_id();
+    auto it = threadTracks.find(id);
+    if (it != threadTracks.end()) {
+        return it->second;
+    }
+    int track = static_cast<int>(threadTracks.size()) + 1;
+    threadTracks[id] = track;
+    return track;
+}
+
+void writeEscaped(std::ostream& out, const std::string& text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << ' ';
+        } else {
+            out << c;
+        }
+    }
+}
+
+} // namespace
+
+void start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+    enabled.store(true);
+    std::cout << "Trace recording started" << std::endl;
+}
+
+bool isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - clockOrigin).count();
+}
+
+void setThreadName(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    trackNames[currentTrack()] = name;
+}
+
+void complete(const char* category, const std::string& name, uint64_t start, uint64_t duration,
+              const std::string& args) {
+    if (!isEnabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(Event{name, category, start, duration, currentTrack(), args});
+}
+
+void completeOnTrack(int track, const char* category, const std::string& name,
+                     uint64_t start, uint64_t duration, const std::string& args) {
+    if (!isEnabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(Event{name, category, start, duration, track, args});
+}
+
+bool stop(const std::string& filename) {
+    enabled.store(false);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ofstream file(filename);
+    if (!file) {
+        std::cerr << "Failed to open trace file for writing: " << filename << std::endl;
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+
+    // Track names first so viewers label the rows
+    std::map<int, std::string> names = trackNames;
+    names[DEVICE_TRACK] = "OpenCL device";
+    for (const auto& entry : names) {
+        file << (first ? "" : ",\n")
+             << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << entry.first
+             << ", \"args\": {\"name\": \"";
+        writeEscaped(file, entry.second);
+        file << "\"}}";
+        first = false;
+    }
+
+    for (const Event& event : events) {
+        file << (first ? "" : ",\n") << "{\"ph\": \"X\", \"name\": \"";
+        writeEscaped(file, event.name);
+        file << "\", \"cat\": \"" << event.category << "\", \"pid\": 1, \"tid\": " << event.track
+             << ", \"ts\": " << event.start << ", \"dur\": " << event.duration;
+        if (!event.args.empty()) {
+            file << ", \"args\": {" << event.args << "}";
+        }
+        file << "}";
+        first = false;
+    }
+    file << "\n]}\n";
+
+    std::cout << "Wrote " << events.size() << " trace events to " << filename << std::endl;
+    events.clear();
+    return file.good();
+}
+
+ScopedEvent::ScopedEvent(const char* category, const char* name)
+    : category(category), name(name), startTime(0), active(isEnabled())
+{
+    if (active) {
+        startTime = now();
+    }
+}
+
+ScopedEvent::~ScopedEvent() {
+    if (active) {
+        complete(category, name, startTime, now() - startTime, args);
+    }
+}
+
+} // namespace Trace
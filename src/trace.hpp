@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Timeline recorder that writes Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Recording is off by default; while it is off every call returns after one relaxed load.
+namespace Trace {
+    // Pseudo thread id for events that happen on the OpenCL device rather than a host thread
+    const int DEVICE_TRACK = 1000;
+
+    void start();
+    // Stops recording and writes all events collected since start()
+    bool stop(const std::string& filename);
+    bool isEnabled();
+
+    // Microseconds on the trace clock
+    uint64_t now();
+
+    void setThreadName(const std::string& name);
+
+    // Complete event on the calling thread; args is a JSON object body such as "\"tile\": 3"
+    void complete(const char* category, const std::string& name, uint64_t start, uint64_t duration,
+                  const std::string& args = "");
+    // Complete event on an explicit track, e.g. DEVICE_TRACK
+    void completeOnTrack(int track, const char* category, const std::string& name,
+                         uint64_t start, uint64_t duration, const std::string& args = "");
+
+    // Records the enclosing scope as a complete event
+    class ScopedEvent {
+    public:
+        ScopedEvent(const char* category, const char* name);
+        ~ScopedEvent();
+
+        ScopedEvent(const ScopedEvent&) = delete;
+        ScopedEvent& operator=(const ScopedEvent&) = delete;
+
+        void setArgs(const std::string& eventArgs) { args = eventArgs; }
+
+    private:
+        const char* category;
+        const char* name;
+        uint64_t startTime;
+        bool active;
+        std::string args;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(category, name) Trace::ScopedEvent TRACE_CONCAT(traceScope, __LINE__)(category, name)
@@ -0,0 +1,132 @@
+#include "view_state.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const double TWO_PI = 6.283185307179586;
+
+template <typename T>
+T readField(const unsigned char* data, size_t offset) {
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void writeField(unsigned char* data, size_t offset, T value) {
+    std::memcpy(data + offset, &value, sizeof(T));
+}
+
+// Flags are stored as one byte; anything but 0 or 1 means the file is not a view
+bool readFlag(const unsigned char* data, size_t offset, bool& flag) {
+    if (data[offset] > 1) {
+        return false;
+    }
+    flag = data[offset] == 1;
+    return true;
+}
+
+} // namespace
+
+bool parseViewState(const unsigned char* data, size_t size, const ViewStateLimits& limits,
+                    ViewState& state, std::string& error) {
+    if (size != VIEW_STATE_FILE_SIZE) {
+        error = "expected " + std::to_string(VIEW_STATE_FILE_SIZE) + " bytes, got " + std::to_string(size);
+        return false;
+    }
+
+    ViewState parsed;
+    parsed.centerX = readField<double>(data, offsetof(ViewState, centerX));
+    parsed.centerY = readField<double>(data, offsetof(ViewState, centerY));
+    parsed.zoom = readField<double>(data, offsetof(ViewState, zoom));
+    parsed.maxIterations = readField<int>(data, offsetof(ViewState, maxIterations));
+    parsed.colorMode = readField<int>(data, offsetof(ViewState, colorMode));
+    parsed.colorShift = readField<double>(data, offsetof(ViewState, colorShift));
+    parsed.highQualityMultiplier = readField<int>(data, offsetof(ViewState, highQualityMultiplier));
+    if (!readFlag(data, offsetof(ViewState, highQualityMode), parsed.highQualityMode) ||
+        !readFlag(data, offsetof(ViewState, adaptiveRenderScale), parsed.adaptiveRenderScale) ||
+        !readFlag(data, offsetof(ViewState, smoothZoomMode), parsed.smoothZoomMode)) {
+        error = "invalid flag byte";
+        return false;
+    }
+
+    if (!std::isfinite(parsed.centerX) || !std::isfinite(parsed.centerY)) {
+        error = "center is not a finite number";
+        return false;
+    }
+    if (!(parsed.zoom > 0.0 && parsed.zoom <= limits.maxZoom)) {
+        error = "zoom must be above 0 and at most " + std::to_string(limits.maxZoom);
+        return false;
+    }
+    if (parsed.colorMode < 0 || parsed.colorMode >= VIEW_COLOR_MODES) {
+        error = "color mode " + std::to_string(parsed.colorMode) + " is out of range";
+        return false;
+    }
+    // Saved shifts are always normalised; a huge one would stall normalisation
+    if (!(parsed.colorShift >= 0.0 && parsed.colorShift <= TWO_PI)) {
+        error = "color shift must be between 0 and 2 pi";
+        return false;
+    }
+    if (parsed.highQualityMultiplier < 1 || parsed.highQualityMultiplier > limits.maxQualityMultiplier) {
+        error = "quality multiplier must be between 1 and " + std::to_string(limits.maxQualityMultiplier);
+        return false;
+    }
+    // Checked with the multiplier either way, since Y switches to it after loading
+    const int64_t highQualityIterations = static_cast<int64_t>(parsed.maxIterations) * parsed.highQualityMultiplier;
+    const int64_t effective = parsed.highQualityMode ? highQualityIterations : parsed.maxIterations;
+    if (parsed.maxIterations < 1 || effective > limits.maxIterations || highQualityIterations > INT32_MAX) {
+        error = "iteration limit " + std::to_string(effective) + " is outside 1 to " +
+                std::to_string(limits.maxIterations);
+        return false;
+    }
+
+    state = parsed;
+    return true;
+}
+
+bool saveViewState(const std::string& filename, const ViewState& state) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open file for writing: " << filename << std::endl;
+        return false;
+    }
+
+    // Field by field into zeroed bytes, so padding doesn't carry stack contents to disk
+    unsigned char data[VIEW_STATE_FILE_SIZE] = {};
+    writeField(data, offsetof(ViewState, centerX), state.centerX);
+    writeField(data, offsetof(ViewState, centerY), state.centerY);
+    writeField(data, offsetof(ViewState, zoom), state.zoom);
+    writeField(data, offsetof(ViewState, maxIterations), state.maxIterations);
+    writeField(data, offsetof(ViewState, colorMode), state.colorMode);
+    writeField(data, offsetof(ViewState, colorShift), state.colorShift);
+    writeField<unsigned char>(data, offsetof(ViewState, highQualityMode), state.highQualityMode);
+    writeField(data, offsetof(ViewState, highQualityMultiplier), state.highQualityMultiplier);
+    writeField<unsigned char>(data, offsetof(ViewState, adaptiveRenderScale), state.adaptiveRenderScale);
+    writeField<unsigned char>(data, offsetof(ViewState, smoothZoomMode), state.smoothZoomMode);
+
+    file.write(reinterpret_cast<const char*>(data), sizeof(data));
+    return file.good();
+}
+
+bool loadViewState(const std::string& filename, ViewState& state, const ViewStateLimits& limits) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open file for reading: " << filename << std::endl;
+        return false;
+    }
+
+    // One byte more than a view, so an oversized file is noticed without reading it all
+    std::vector<unsigned char> data(VIEW_STATE_FILE_SIZE + 1);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    std::string error;
+    if (file.bad() || !parseViewState(data.data(), static_cast<size_t>(file.gcount()), limits, state, error)) {
+        std::cerr << "Rejected view file " << filename << ": " << (file.bad() ? "read error" : error) << std::endl;
+        return false;
+    }
+    return true;
+}
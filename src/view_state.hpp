@@ -1,8 +1,7 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
-#include <fstream>
-#include <iostream>
 
 struct ViewState {
     double centerX;
@@ -17,24 +16,28 @@ struct ViewState {
     bool smoothZoomMode;
 };
 
-bool saveViewState(const std::string& filename, const ViewState& state) {
-    std::ofstream file(filename, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open file for writing: " << filename << std::endl;
-        return false;
-    }
-
-    file.write(reinterpret_cast<const char*>(&state), sizeof(ViewState));
-    return file.good();
-}
-
-bool loadViewState(const std::string& filename, ViewState& state) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open file for reading: " << filename << std::endl;
-        return false;
-    }
-
-    file.read(reinterpret_cast<char*>(&state), sizeof(ViewState));
-    return file.good();
-} 
\ No newline at end of file
+// Bounds a view file must stay within to be loaded. Everything else about the file
+// (size, flags, finite numbers, palette index) is checked regardless.
+struct ViewStateLimits {
+    int maxIterations = 1 << 24;         // Effective limit, after the high quality multiplier
+    int maxQualityMultiplier = 320;      // Largest the J/K keys allow
+    double maxZoom = 1e15;               // Pixels are below double precision long before this
+};
+
+// Number of colour palettes a view can select
+const int VIEW_COLOR_MODES = 6;
+
+// A view file is the ViewState fields at their in-memory offsets, VIEW_STATE_FILE_SIZE bytes
+// with zero padding. The parser reads each field from its offset, so no byte of the input
+// is ever reinterpreted as a bool or left uninitialised, and rejects the input with a
+// message unless every field is in range.
+const size_t VIEW_STATE_FILE_SIZE = sizeof(ViewState);
+
+bool parseViewState(const unsigned char* data, size_t size, const ViewStateLimits& limits,
+                    ViewState& state, std::string& error);
+
+bool saveViewState(const std::string& filename, const ViewState& state);
+
+// Reads and parses a view file; prints the reason to std::cerr if it is rejected
+bool loadViewState(const std::string& filename, ViewState& state,
+                   const ViewStateLimits& limits = ViewStateLimits());
@@ -0,0 +1,30 @@
+// libFuzzer entry point for the view file parser. Build with -DMANDELBROT_FUZZ=ON using
+// Clang, then run e.g. `view_state_fuzzer -max_len=128 corpus/` with saved .view files
+// as the seed corpus. AddressSanitizer and UndefinedBehaviorSanitizer are linked in, so
+// an out-of-bounds read, bad bool load or signed overflow stops the run.
+#include "view_state.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    ViewState state;
+    std::string error;
+    ViewStateLimits limits;
+    if (!parseViewState(data, size, limits, state, error)) {
+        if (error.empty()) {
+            std::abort();
+        }
+        return 0;
+    }
+
+    // Whatever is accepted must be safe to hand to the viewer as is
+    int64_t effective = state.highQualityMode ? static_cast<int64_t>(state.maxIterations) * state.highQualityMultiplier
+                                              : state.maxIterations;
+    if (state.colorMode < 0 || state.colorMode >= VIEW_COLOR_MODES || effective < 1 ||
+        effective > limits.maxIterations || !(state.zoom > 0.0) || !std::isfinite(state.centerX) ||
+        !std::isfinite(state.centerY) || !std::isfinite(state.colorShift)) {
+        std::abort();
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "viewport.hpp"
+#include <algorithm>
+#include <cmath>
+#include "trace.hpp"
+
+Viewport::Viewport(SDL_Renderer* renderer, RenderScheduler& scheduler, TileCache& cache, const SDL_Rect& rect)
+    : scheduler(scheduler), cache(cache), clientId(scheduler.addClient()), rect(rect),
+      centerX(-0.5), centerY(0.0), zoom(1.0), maxIterations(200), colorMode(0), colorShift(0.0),
+      viewChanged(true), colorsChanged(true), frameRecorded(false), originX(0), originY(0),
+      tileRgb(TILE_SIZE * TILE_SIZE * 3)
+{
+    imageData.assign(static_cast<size_t>(rect.w) * rect.h * 3, 0);
+    uploader.reset(new TextureUploader(renderer, rect.w, rect.h));
+}
+
+void Viewport::setRect(const SDL_Rect& newRect) {
+    if (newRect.w != rect.w || newRect.h != rect.h) {
+        imageData.assign(static_cast<size_t>(newRect.w) * newRect.h * 3, 0);
+        uploader->resize(newRect.w, newRect.h);
+        viewChanged = true;
+    }
+    rect = newRect;
+}
+
+void Viewport::setView(double newCenterX, double newCenterY, double newZoom,
+                       int newMaxIterations, int newColorMode, double newColorShift) {
+    if (newCenterX != centerX || newCenterY != centerY || newZoom != zoom ||
+        newMaxIterations != maxIterations) {
+        viewChanged = true;
+    }
+    if (newColorMode != colorMode || newColorShift != colorShift) {
+        colorsChanged = true;
+    }
+    centerX = newCenterX;
+    centerY = newCenterY;
+    zoom = newZoom;
+    maxIterations = newMaxIterations;
+    colorMode = newColorMode;
+    colorShift = newColorShift;
+}
+
+bool Viewport::contains(int x, int y) const {
+    return x >= rect.x && x < rect.x + rect.w && y >= rect.y && y < rect.y + rect.h;
+}
+
+void Viewport::rebuildTiles() {
+    const double pixelSize = getPixelSize();
+
+    // Snap the view to the global pixel grid so tiles can be shared
+    originX = std::llround(centerX / pixelSize) - rect.w / 2;
+    originY = std::llround(centerY / pixelSize) - rect.h / 2;
+
+    int64_t firstTileX = TileRenderer::tileIndex(originX);
+    int64_t firstTileY = TileRenderer::tileIndex(originY);
+    int64_t lastTileX = TileRenderer::tileIndex(originX + rect.w - 1);
+    int64_t lastTileY = TileRenderer::tileIndex(originY + rect.h - 1);
+
+    visibleTiles.clear();
+    for (int64_t ty = firstTileY; ty <= lastTileY; ++ty) {
+        for (int64_t tx = firstTileX; tx <= lastTileX; ++tx) {
+            visibleTiles.push_back({TileKey{pixelSize, tx, ty, maxIterations}, false});
+        }
+    }
+
+    // Render from the center outwards
+    const double midX = static_cast<double>(originX + rect.w / 2) / TILE_SIZE;
+    const double midY = static_cast<double>(originY + rect.h / 2) / TILE_SIZE;
+    std::sort(visibleTiles.begin(), visibleTiles.end(), [&](const VisibleTile& a, const VisibleTile& b) {
+        double da = std::hypot(a.key.tileX + 0.5 - midX, a.key.tileY + 0.5 - midY);
+        double db = std::hypot(b.key.tileX + 0.5 - midX, b.key.tileY + 0.5 - midY);
+        return da < db;
+    });
+
+    // Preview of the new view from earlier frames while its tiles render
+    pyramid.compose(imageData.data(), rect.w, rect.h, (originX + rect.w / 2) * pixelSize,
+                    (originY + rect.h / 2) * pixelSize, pixelSize);
+    uploader->markAllDirty();
+    frameRecorded = false;
+
+    std::vector<TileKey> keys;
+    keys.reserve(visibleTiles.size());
+    for (const VisibleTile& tile : visibleTiles) {
+        keys.push_back(tile.key);
+    }
+    scheduler.submit(clientId, keys);
+}
+
+void Viewport::placeTile(const TileKey& key, const TileIterations& tile) {
+    TileRenderer::colorize(tile.data(), tile.size(), key.maxIterations, colorMode, colorShift, tileRgb.data());
+
+    // Tile position in local pixel coordinates
+    int64_t tileLeft = key.tileX * TILE_SIZE - originX;
+    int64_t tileTop = key.tileY * TILE_SIZE - originY;
+    int x0, y0, x1, y1;
+    if (TileRenderer::copyTileToImage(tileRgb.data(), tileLeft, tileTop, imageData.data(),
+                                      rect.w, rect.h, x0, y0, x1, y1)) {
+        SDL_Rect dirty = {x0, y0, x1 - x0, y1 - y0};
+        uploader->markDirty(dirty);
+    }
+}
+
+void Viewport::update() {
+    TRACE_SCOPE("viewport", "viewport update");
+    if (viewChanged) {
+        if (colorsChanged) {
+            pyramid.clear();
+        }
+        rebuildTiles();
+        viewChanged = false;
+        colorsChanged = false;
+    } else if (colorsChanged) {
+        // Recolour from cached iterations; tiles evicted since are submitted again below
+        for (VisibleTile& tile : visibleTiles) {
+            tile.placed = false;
+        }
+        colorsChanged = false;
+        pyramid.clear();
+        frameRecorded = false;
+    }
+
+    std::vector<TileKey> missing;
+    for (VisibleTile& tile : visibleTiles) {
+        if (tile.placed) {
+            continue;
+        }
+        std::shared_ptr<const TileIterations> iterations = cache.find(tile.key);
+        if (iterations) {
+            placeTile(tile.key, *iterations);
+            tile.placed = true;
+        } else {
+            missing.push_back(tile.key);
+        }
+    }
+    // Other viewports and batch jobs share the cache, so a finished tile can be evicted
+    // before it is placed; without another submit it would stay a hole
+    if (!missing.empty() && !scheduler.unscheduled(clientId, missing).empty()) {
+        scheduler.submit(clientId, missing);
+    }
+
+    if (!frameRecorded && std::all_of(visibleTiles.begin(), visibleTiles.end(),
+                                      [](const VisibleTile& tile) { return tile.placed; })) {
+        const double pixelSize = getPixelSize();
+        pyramid.addFrame(imageData.data(), rect.w, rect.h, (originX + rect.w / 2) * pixelSize,
+                         (originY + rect.h / 2) * pixelSize, pixelSize);
+        frameRecorded = true;
+    }
+
+    uploader->upload(imageData.data(), rect.w * 3);
+}
+
+void Viewport::draw(SDL_Renderer* renderer, bool active) {
+    SDL_RenderCopy(renderer, uploader->getTexture(), nullptr, &rect);
+
+    if (active) {
+        SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+    } else {
+        SDL_SetRenderDrawColor(renderer, 100, 100, 100, 255);
+    }
+    SDL_RenderDrawRect(renderer, &rect);
+}
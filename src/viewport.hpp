@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <SDL2/SDL.h>
+#include "lod_pyramid.hpp"
+#include "render_scheduler.hpp"
+#include "texture_uploader.hpp"
+
+// One independent view inside a multi-view workspace. Tiles are requested from the
+// shared scheduler and composited into the viewport's own texture as they arrive.
+// Until they do, a new view is filled in from earlier frames of this viewport.
+class Viewport {
+public:
+    Viewport(SDL_Renderer* renderer, RenderScheduler& scheduler, TileCache& cache, const SDL_Rect& rect);
+
+    void setRect(const SDL_Rect& newRect);
+    void setView(double centerX, double centerY, double zoom, int maxIterations, int colorMode, double colorShift);
+
+    // Submits tiles when the view changed and composites any finished tiles
+    void update();
+    void draw(SDL_Renderer* renderer, bool active);
+
+    bool contains(int x, int y) const;
+    const SDL_Rect& getRect() const { return rect; }
+    // Size of one viewport pixel in the complex plane
+    double getPixelSize() const { return 4.0 / zoom / rect.h; }
+
+
+private:
+    struct VisibleTile {
+        TileKey key;
+        bool placed;
+    };
+
+    void rebuildTiles();
+    void placeTile(const TileKey& key, const TileIterations& tile);
+
+    RenderScheduler& scheduler;
+    TileCache& cache;
+    int clientId;
+    SDL_Rect rect;
+
+    double centerX;
+    double centerY;
+    double zoom;
+    int maxIterations;
+    int colorMode;
+    double colorShift;
+
+    bool viewChanged;
+    bool colorsChanged;
+    bool frameRecorded;  // Current view is complete and stored in the pyramid
+    int64_t originX;  // Global pixel grid position of the viewport's top-left pixel
+    int64_t originY;
+
+    std::vector<VisibleTile> visibleTiles;
+    std::vector<unsigned char> imageData;
+    std::vector<unsigned char> tileRgb;
+    std::unique_ptr<TextureUploader> uploader;
+    LodPyramid pyramid;
+};
@@ -0,0 +1,128 @@
+#include "zoom_path.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// Smallest area of the global grid that every sub-frame in first..first+count-1 samples
+ZoomPath::Cover coverFor(double centerX, double centerY, int width, int height,
+                         const std::vector<double>& zooms, int first, int count) {
+    const auto range = std::minmax_element(zooms.begin() + first, zooms.begin() + first + count);
+    const double largestPixel = 4.0 / *range.first / height;
+    const double smallestPixel = 4.0 / *range.second / height;
+
+    ZoomPath::Cover cover;
+    cover.first = first;
+    cover.count = count;
+    cover.pixelSize = ZoomPath::quantizePixelSize(smallestPixel);
+    // Frame pixel x sits at centerX + (x - width / 2) * pixelSize; one more column and
+    // row on the far side give the bilinear filter its neighbours
+    const double left = centerX - width / 2.0 * largestPixel;
+    const double right = centerX + (width / 2.0 - 1.0) * largestPixel;
+    const double top = centerY - height / 2.0 * largestPixel;
+    const double bottom = centerY + (height / 2.0 - 1.0) * largestPixel;
+    cover.originX = static_cast<int64_t>(std::floor(left / cover.pixelSize));
+    cover.originY = static_cast<int64_t>(std::floor(top / cover.pixelSize));
+    cover.width = static_cast<int>(static_cast<int64_t>(std::floor(right / cover.pixelSize)) + 2 - cover.originX);
+    cover.height = static_cast<int>(static_cast<int64_t>(std::floor(bottom / cover.pixelSize)) + 2 - cover.originY);
+    return cover;
+}
+
+} // namespace
+
+namespace ZoomPath {
+
+double zoomAt(double startZoom, double endZoom, int frames, double t) {
+    if (frames <= 1) {
+        return startZoom;
+    }
+    // Geometric, so every frame zooms by the same factor
+    return startZoom * std::pow(endZoom / startZoom, t / (frames - 1));
+}
+
+std::vector<double> subFrameZooms(double startZoom, double endZoom, int frames, int frame,
+                                  int samples, double shutter) {
+    std::vector<double> zooms;
+    for (int s = 0; s < samples; ++s) {
+        const double offset = samples > 1 ? shutter * ((s + 0.5) / samples - 0.5) : 0.0;
+        zooms.push_back(zoomAt(startZoom, endZoom, frames, frame + offset));
+    }
+    return zooms;
+}
+
+double quantizePixelSize(double pixelSize) {
+    // Same inputs give bit-identical sizes, so tile keys match between frames
+    return std::exp2(std::floor(std::log2(pixelSize) * COVER_STEPS_PER_OCTAVE) / COVER_STEPS_PER_OCTAVE);
+}
+
+std::vector<Cover> planCovers(double centerX, double centerY, int width, int height,
+                              const std::vector<double>& zooms) {
+    const double framePixels = static_cast<double>(width) * height;
+    const int samples = static_cast<int>(zooms.size());
+    std::vector<Cover> covers;
+    int first = 0;
+    while (first < samples) {
+        Cover cover = coverFor(centerX, centerY, width, height, zooms, first, 1);
+        for (int count = 2; first + count <= samples; ++count) {
+            Cover grown = coverFor(centerX, centerY, width, height, zooms, first, count);
+            if (static_cast<double>(grown.width) * grown.height > count * framePixels) {
+                break;
+            }
+            cover = grown;
+        }
+        covers.push_back(cover);
+        first += cover.count;
+    }
+    return covers;
+}
+
+void accumulate(const Cover& cover, const unsigned char* coverRgb, double centerX, double centerY,
+                double zoom, int width, int height, float* accumulator) {
+    const double pixelSize = 4.0 / zoom / height;
+    const double scale = pixelSize / cover.pixelSize;
+    // Offsets from the cover origin stay small, so deep zooms keep their precision
+    const double baseX = centerX / cover.pixelSize - cover.originX;
+    const double baseY = centerY / cover.pixelSize - cover.originY;
+
+    std::vector<int> columns(width);
+    std::vector<float> columnWeights(width);
+    for (int x = 0; x < width; ++x) {
+        const double fx = baseX + (x - width / 2.0) * scale;
+        const int column = std::min(std::max(static_cast<int>(std::floor(fx)), 0), cover.width - 2);
+        columns[x] = column;
+        columnWeights[x] = static_cast<float>(std::min(std::max(fx - column, 0.0), 1.0));
+    }
+
+    for (int y = 0; y < height; ++y) {
+        const double fy = baseY + (y - height / 2.0) * scale;
+        const int row = std::min(std::max(static_cast<int>(std::floor(fy)), 0), cover.height - 2);
+        const float rowWeight = static_cast<float>(std::min(std::max(fy - row, 0.0), 1.0));
+        const unsigned char* upper = coverRgb + static_cast<size_t>(row) * cover.width * 3;
+        const unsigned char* lower = upper + static_cast<size_t>(cover.width) * 3;
+        float* out = accumulator + static_cast<size_t>(y) * width * 3;
+
+        for (int x = 0; x < width; ++x) {
+            const int i = columns[x] * 3;
+            const float w = columnWeights[x];
+            for (int c = 0; c < 3; ++c) {
+                const float top = upper[i + c] + (upper[i + 3 + c] - upper[i + c]) * w;
+                const float bottom = lower[i + c] + (lower[i + 3 + c] - lower[i + c]) * w;
+                out[x * 3 + c] += top + (bottom - top) * rowWeight;
+            }
+        }
+    }
+}
+
+std::string frameFilename(const std::string& output, int frame) {
+    char number[16];
+    std::snprintf(number, sizeof(number), "_%05d", frame);
+    const size_t dot = output.rfind('.');
+    const size_t separator = output.find_last_of("/\\");
+    if (dot == std::string::npos || (separator != std::string::npos && dot < separator)) {
+        return output + number;
+    }
+    return output.substr(0, dot) + number + output.substr(dot);
+}
+
+} // namespace ZoomPath
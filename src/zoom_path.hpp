@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Geometry of zoom-path animations: frames zoom into a fixed centre at a constant rate,
+// and each frame may average several sub-frames spread over part of the frame interval
+// (motion blur). Sub-frames are not rendered one by one: consecutive ones are cropped
+// and resampled from one shared "cover" image, rendered on the global tile grid at a
+// pixel size quantised to COVER_STEPS_PER_OCTAVE steps, so neighbouring frames at the
+// same step also reuse each other's cached tiles.
+namespace ZoomPath {
+    const int COVER_STEPS_PER_OCTAVE = 4;
+
+    // Zoom at frame time t (fractional, 0 is the first frame) of a path that goes from
+    // startZoom to endZoom in frames frames
+    double zoomAt(double startZoom, double endZoom, int frames, double t);
+
+    // Zooms of the sub-frames of one frame, spread evenly across shutter frame
+    // intervals centred on it, in path order
+    std::vector<double> subFrameZooms(double startZoom, double endZoom, int frames, int frame,
+                                      int samples, double shutter);
+
+    // Pixel size on the quantised grid, no larger than pixelSize
+    double quantizePixelSize(double pixelSize);
+
+    // An area of the global tile grid that sub-frames first..first+count-1 are resampled from
+    struct Cover {
+        int first;
+        int count;
+        double pixelSize;
+        int64_t originX;  // Global pixel coordinates of the top-left pixel
+        int64_t originY;
+        int width;
+        int height;
+    };
+
+    // Groups sub-frames (in path order) into covers. A group grows while its cover has
+    // no more pixels than its sub-frames would have rendered separately.
+    std::vector<Cover> planCovers(double centerX, double centerY, int width, int height,
+                                  const std::vector<double>& zooms);
+
+    // Adds a bilinear resample of cover (RGB24) as seen by a width x height frame at the
+    // given zoom to accumulator (three floats per pixel)
+    void accumulate(const Cover& cover, const unsigned char* coverRgb, double centerX, double centerY,
+                    double zoom, int width, int height, float* accumulator);
+
+    // "zoom.png" -> "zoom_00042.png"
+    std::string frameFilename(const std::string& output, int frame);
+}
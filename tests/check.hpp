@@ -0,0 +1,18 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal assertion for the unit tests: reports the failed expression and counts it,
+// so one run lists every failure. Each test's main returns checkFailures() != 0.
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition "\n"; \
+            ++checkFailures();                                                            \
+        }                                                                                 \
+    } while (0)
@@ -0,0 +1,109 @@
+#include "check.hpp"
+#include "tile_codec.hpp"
+#include <climits>
+#include <random>
+#include <vector>
+
+namespace {
+
+bool roundTrips(const std::vector<int>& values, int width, int height, size_t* encodedBytes = nullptr) {
+    std::vector<uint8_t> encoded;
+    TileCodec::encode(values.data(), width, height, encoded);
+    if (encodedBytes) {
+        *encodedBytes = encoded.size();
+    }
+    std::vector<int> decoded(values.size(), -1);
+    return TileCodec::decode(encoded.data(), encoded.size(), width, height, decoded.data()) && decoded == values;
+}
+
+void testRuns() {
+    // An interior tile at maxIterations is a single run token
+    const int maxIterations = 1 << 20;
+    std::vector<int> interior(64 * 64, maxIterations);
+    size_t bytes = 0;
+    CHECK(roundTrips(interior, 64, 64, &bytes));
+    CHECK(bytes <= 8);
+
+    // Runs broken by single values, and runs that cross row starts
+    std::vector<int> striped(64 * 64, 7);
+    for (size_t i = 0; i < striped.size(); i += 97) {
+        striped[i] = maxIterations;
+    }
+    CHECK(roundTrips(striped, 64, 64));
+
+    std::vector<int> zeros(64 * 64, 0);
+    CHECK(roundTrips(zeros, 64, 64, &bytes));
+    CHECK(bytes <= 4);
+}
+
+void testResiduals() {
+    // Falling values give negative residuals, alternating extremes the largest ones
+    std::vector<int> falling(64 * 64);
+    for (size_t i = 0; i < falling.size(); ++i) {
+        falling[i] = 100000 - static_cast<int>(i) * 13;
+    }
+    CHECK(roundTrips(falling, 64, 64));
+
+    std::vector<int> extremes(16 * 4);
+    for (size_t i = 0; i < extremes.size(); ++i) {
+        extremes[i] = (i % 3 == 0) ? INT_MIN : (i % 3 == 1 ? INT_MAX : 0);
+    }
+    CHECK(roundTrips(extremes, 16, 4));
+
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<int> iterations(0, 1 << 24);
+    std::vector<int> noise(64 * 64);
+    for (int& value : noise) {
+        value = iterations(random);
+    }
+    CHECK(roundTrips(noise, 64, 64));
+}
+
+void testShapes() {
+    std::vector<int> single(1, 42);
+    CHECK(roundTrips(single, 1, 1));
+
+    // Odd widths exercise the prediction from the row above
+    std::vector<int> odd(37 * 5);
+    for (size_t i = 0; i < odd.size(); ++i) {
+        odd[i] = static_cast<int>((i * 7919) % 300);
+    }
+    CHECK(roundTrips(odd, 37, 5));
+    CHECK(roundTrips(odd, 5, 37));
+}
+
+void testCorruptInput() {
+    std::vector<int> values(64 * 64);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<int>(i % 500);
+    }
+    std::vector<uint8_t> encoded;
+    TileCodec::encode(values.data(), 64, 64, encoded);
+    std::vector<int> decoded(values.size());
+
+    // Truncated, with trailing bytes, and for the wrong number of values
+    CHECK(!TileCodec::decode(encoded.data(), encoded.size() - 1, 64, 64, decoded.data()));
+    std::vector<uint8_t> padded = encoded;
+    padded.push_back(0);
+    CHECK(!TileCodec::decode(padded.data(), padded.size(), 64, 64, decoded.data()));
+    CHECK(!TileCodec::decode(encoded.data(), encoded.size(), 64, 32, decoded.data()));
+
+    // A run longer than the grid
+    std::vector<uint8_t> longRun;
+    TileCodec::encode(std::vector<int>(64 * 64, 0).data(), 64, 64, longRun);
+    CHECK(!TileCodec::decode(longRun.data(), longRun.size(), 8, 8, decoded.data()));
+
+    // A varint that never ends
+    std::vector<uint8_t> endless(16, 0xFF);
+    CHECK(!TileCodec::decode(endless.data(), endless.size(), 64, 64, decoded.data()));
+}
+
+} // namespace
+
+int main() {
+    testRuns();
+    testResiduals();
+    testShapes();
+    testCorruptInput();
+    return checkFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#include "check.hpp"
+#include "tile_store.hpp"
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace {
+
+const size_t STORE_BYTES = 4 * 1024 * 1024;  // The smallest store
+
+TileKey keyFor(int index) {
+    return TileKey{1.0 / 1024, index, -index, 500};
+}
+
+// Noisy tiles compress poorly, so a few hundred fill the ring
+TileIterations noisyTile(int index) {
+    std::mt19937 random(index);
+    std::uniform_int_distribution<int> iterations(0, 500);
+    TileIterations tile(TILE_SIZE * TILE_SIZE);
+    for (int& value : tile) {
+        value = iterations(random);
+    }
+    return tile;
+}
+
+// Constant tiles compress to a few bytes, so the index fills before the ring
+TileIterations flatTile(int index) {
+    return TileIterations(TILE_SIZE * TILE_SIZE, index % 500);
+}
+
+bool holds(TileStore& store, int index, const TileIterations& expected) {
+    TileIterations loaded;
+    return store.load(keyFor(index), loaded) && loaded == expected;
+}
+
+void testReopen(const std::string& filename) {
+    std::remove(filename.c_str());
+    {
+        TileStore store(filename, STORE_BYTES);
+        CHECK(store.size() == 0);
+        for (int i = 0; i < 50; ++i) {
+            store.save(keyFor(i), noisyTile(i));
+        }
+        CHECK(store.size() == 50);
+        TileIterations missing;
+        CHECK(!store.load(keyFor(1000), missing));
+    }
+
+    // A cleanly closed store comes back with every tile
+    TileStore store(filename, STORE_BYTES);
+    CHECK(store.size() == 50);
+    for (int i = 0; i < 50; ++i) {
+        CHECK(holds(store, i, noisyTile(i)));
+    }
+
+    // Saving a tile again replaces it
+    store.save(keyFor(3), flatTile(3));
+    CHECK(holds(store, 3, flatTile(3)));
+    CHECK(store.size() == 50);
+}
+
+void testWrapAndEviction(const std::string& filename) {
+    std::remove(filename.c_str());
+    const int tileCount = 2000;  // Several times round the ring
+    {
+        TileStore store(filename, STORE_BYTES);
+        for (int i = 0; i < tileCount; ++i) {
+            store.save(keyFor(i), noisyTile(i));
+        }
+        // The oldest tiles were overwritten, the newest are intact
+        CHECK(store.size() < static_cast<size_t>(tileCount));
+        CHECK(!holds(store, 0, noisyTile(0)));
+        for (int i = tileCount - 50; i < tileCount; ++i) {
+            CHECK(holds(store, i, noisyTile(i)));
+        }
+    }
+
+    // Every tile still listed after reopening loads back exactly
+    TileStore store(filename, STORE_BYTES);
+    size_t found = 0;
+    for (int i = 0; i < tileCount; ++i) {
+        TileIterations loaded;
+        if (store.load(keyFor(i), loaded)) {
+            CHECK(loaded == noisyTile(i));
+            ++found;
+        }
+    }
+    CHECK(found == store.size());
+    CHECK(holds(store, tileCount - 1, noisyTile(tileCount - 1)));
+}
+
+void testIndexEviction(const std::string& filename) {
+    std::remove(filename.c_str());
+    TileStore store(filename, STORE_BYTES);
+    // Far more tiny tiles than index slots: old ones are dropped and tombstones swept
+    const int tileCount = 20000;
+    for (int i = 0; i < tileCount; ++i) {
+        store.save(keyFor(i), flatTile(i));
+    }
+    CHECK(store.size() > 0);
+    CHECK(store.size() < static_cast<size_t>(tileCount));
+    CHECK(!holds(store, 0, flatTile(0)));
+    for (int i = tileCount - 100; i < tileCount; ++i) {
+        CHECK(holds(store, i, flatTile(i)));
+    }
+}
+
+} // namespace
+
+int main() {
+    const std::string filename = "tile_store_test.store";
+    testReopen(filename);
+    testWrapAndEviction(filename);
+    testIndexEviction(filename);
+    std::remove(filename.c_str());
+    return checkFailures() == 0 ? 0 : 1;
+}
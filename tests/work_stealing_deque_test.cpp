@@ -0,0 +1,89 @@
+#include "check.hpp"
+#include "work_stealing_deque.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void testSingleThread() {
+    WorkStealingDeque<int> deque(4);
+    int item = 0;
+    CHECK(deque.empty());
+    CHECK(!deque.pop(item));
+    CHECK(!deque.steal(item));
+
+    // Grows past the initial capacity; pop is LIFO, steal FIFO
+    for (int i = 0; i < 100; ++i) {
+        deque.push(i);
+    }
+    CHECK(deque.pop(item) && item == 99);
+    CHECK(deque.steal(item) && item == 0);
+    CHECK(deque.steal(item) && item == 1);
+    CHECK(deque.pop(item) && item == 98);
+
+    int remaining = 0;
+    while (deque.pop(item)) {
+        ++remaining;
+    }
+    CHECK(remaining == 96);
+    CHECK(deque.empty());
+}
+
+// The owner pushes and pops while thieves steal; every item must be taken exactly once
+void testConcurrent() {
+    const int itemCount = 200000;
+    const int thiefCount = 3;
+    WorkStealingDeque<int> deque(16);
+    std::vector<std::atomic<int>> taken(itemCount);
+    for (std::atomic<int>& count : taken) {
+        count.store(0);
+    }
+    std::atomic<bool> ownerDone(false);
+
+    std::vector<std::thread> thieves;
+    for (int t = 0; t < thiefCount; ++t) {
+        thieves.emplace_back([&] {
+            int item;
+            while (!ownerDone.load() || !deque.empty()) {
+                if (deque.steal(item)) {
+                    taken[item].fetch_add(1);
+                }
+            }
+        });
+    }
+
+    int item;
+    for (int i = 0; i < itemCount; ++i) {
+        deque.push(i);
+        // Pop now and then so the owner and thieves race for the last items
+        if (i % 3 == 0 && deque.pop(item)) {
+            taken[item].fetch_add(1);
+        }
+    }
+    while (deque.pop(item)) {
+        taken[item].fetch_add(1);
+    }
+    ownerDone.store(true);
+    for (std::thread& thief : thieves) {
+        thief.join();
+    }
+
+    int wrong = 0;
+    for (const std::atomic<int>& count : taken) {
+        if (count.load() != 1) {
+            ++wrong;
+        }
+    }
+    CHECK(wrong == 0);
+}
+
+} // namespace
+
+int main() {
+    testSingleThread();
+    for (int round = 0; round < 5; ++round) {
+        testConcurrent();
+    }
+    return checkFailures() == 0 ? 0 : 1;
+}